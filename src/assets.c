@@ -12,15 +12,14 @@ Assets *new_assets() {
 
 void assets_paint_save(Assets *this, char *name, Paint *paint) {
 
+    if (paint->colors == NULL) {
+        paint_bake_default_colors(paint);
+    }
+
     if (this->paint_capacity == 0) {
         this->paint = safe_malloc(sizeof(Paint *));
-        this->paint[0] = paint;
         this->paint_capacity = 1;
-        this->paint_count = 1;
-        return;
-    }
-
-    if (this->paint_count == this->paint_capacity) {
+    } else if (this->paint_count == this->paint_capacity) {
         this->paint_capacity += 8;
         this->paint = safe_realloc(this->paint, this->paint_capacity * sizeof(Paint *));
     }
@@ -56,7 +55,13 @@ Paint *assets_paint_find(Assets *this, char *name) {
 }
 
 void assets_delete(Assets *this) {
+    for (int i = 0; i < this->paint_count; i++) {
+        paint_delete(this->paint[i]);
+    }
     free(this->paint);
+    if (this->font != NULL) {
+        font_delete(this->font);
+    }
     table_delete(this->paint_indices);
     free(this);
 }
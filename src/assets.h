@@ -5,6 +5,7 @@
 #ifndef ASSETS_H
 #define ASSETS_H
 
+#include "font.h"
 #include "mem.h"
 #include "paint.h"
 #include "pie.h"
@@ -17,6 +18,7 @@ struct Assets {
     int paint_count;
     int paint_capacity;
     Table *paint_indices;
+    Font *font;
 };
 
 Assets *new_assets();
@@ -0,0 +1,465 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "world.h"
+
+#define BAKE_CACHE_MAGIC 0x50414d4c
+#define BAKE_CACHE_VERSION 1
+#define BAKE_CACHE_PATH 1024
+
+enum SurfaceType {
+    SURFACE_FLOOR,
+    SURFACE_CEILING,
+    SURFACE_WALL,
+};
+
+typedef struct Surface Surface;
+typedef struct Bake Bake;
+
+struct Surface {
+    enum SurfaceType type;
+    Sector *sec;
+    Line *line;
+    Wall *wall;
+    Lightmap *lightmap;
+};
+
+struct Bake {
+    World *world;
+    Light **lights;
+    int light_count;
+    Surface *surfaces;
+    int surface_count;
+    int surface_cap;
+};
+
+static u64 hash_bytes(u64 hash, void *data, usize size) {
+    u8 *bytes = data;
+    for (usize i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+static u64 hash_float(u64 hash, float value) {
+    return hash_bytes(hash, &value, sizeof(float));
+}
+
+static u64 world_hash(World *this, Bake *bake) {
+    u64 hash = 0xcbf29ce484222325;
+    hash = hash_float(hash, LIGHTMAP_TEXEL);
+    for (int i = 0; i < this->sector_count; i++) {
+        Sector *s = this->sectors[i];
+        for (int k = 0; k < s->vec_count; k++) {
+            hash = hash_float(hash, s->vecs[k]->x);
+            hash = hash_float(hash, s->vecs[k]->y);
+        }
+        hash = hash_float(hash, s->bottom);
+        hash = hash_float(hash, s->floor);
+        hash = hash_float(hash, s->ceiling);
+        hash = hash_float(hash, s->top);
+        hash = hash_float(hash, s->anchor_x);
+        hash = hash_float(hash, s->anchor_z);
+        hash = hash_float(hash, s->floor_plane.x);
+        hash = hash_float(hash, s->floor_plane.z);
+        hash = hash_float(hash, s->ceiling_plane.x);
+        hash = hash_float(hash, s->ceiling_plane.z);
+        hash = hash_float(hash, s->light);
+    }
+    for (int i = 0; i < this->line_count; i++) {
+        Line *ld = this->lines[i];
+        u8 walls = (u8)((ld->bottom != NULL) | ((ld->middle != NULL) << 1) | ((ld->top != NULL) << 2));
+        hash = hash_bytes(hash, &walls, sizeof(u8));
+    }
+    for (int i = 0; i < bake->light_count; i++) {
+        Light *l = bake->lights[i];
+        hash = hash_float(hash, l->x);
+        hash = hash_float(hash, l->y);
+        hash = hash_float(hash, l->z);
+        hash = hash_float(hash, l->radius);
+        hash = hash_float(hash, l->intensity);
+    }
+    return hash;
+}
+
+static void add_surface(Bake *bake, enum SurfaceType type, Sector *sec, Line *line, Wall *wall, Lightmap *lightmap) {
+    if (bake->surface_count == bake->surface_cap) {
+        bake->surface_cap += 64;
+        bake->surfaces = safe_realloc(bake->surfaces, bake->surface_cap * sizeof(Surface));
+    }
+    bake->surfaces[bake->surface_count] = (Surface){type, sec, line, wall, lightmap};
+    bake->surface_count++;
+}
+
+static void add_wall(Bake *bake, Line *line, Wall *wall) {
+    if (wall == NULL) {
+        return;
+    }
+    float x = wall->b->x - wall->a->x;
+    float z = wall->b->y - wall->a->y;
+    if (wall->lightmap != NULL) {
+        lightmap_delete(wall->lightmap);
+    }
+    wall->lightmap = new_lightmap(sqrtf(x * x + z * z), fmaxf(wall->ceiling - wall->floor, wall->ceiling_b - wall->floor_b));
+    add_surface(bake, SURFACE_WALL, NULL, line, wall, wall->lightmap);
+}
+
+static bool has_line(Bake *bake, Line *line) {
+    for (int i = 0; i < bake->surface_count; i++) {
+        if (bake->surfaces[i].line == line) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void add_sector(Bake *bake, Sector *s) {
+    float left = FLT_MAX;
+    float bottom = FLT_MAX;
+    float right = -FLT_MAX;
+    float top = -FLT_MAX;
+    for (int i = 0; i < s->vec_count; i++) {
+        Vec *v = s->vecs[i];
+        left = fminf(left, v->x);
+        right = fmaxf(right, v->x);
+        bottom = fminf(bottom, v->y);
+        top = fmaxf(top, v->y);
+    }
+
+    s->lightmap_x = left;
+    s->lightmap_z = bottom;
+
+    if (s->floor_lightmap != NULL) {
+        lightmap_delete(s->floor_lightmap);
+    }
+    if (s->ceiling_lightmap != NULL) {
+        lightmap_delete(s->ceiling_lightmap);
+    }
+
+    s->floor_lightmap = new_lightmap(right - left, top - bottom);
+    s->ceiling_lightmap = new_lightmap(right - left, top - bottom);
+
+    float width = (float)s->floor_lightmap->width * LIGHTMAP_TEXEL;
+    float height = (float)s->floor_lightmap->height * LIGHTMAP_TEXEL;
+
+    for (int i = 0; i < s->triangle_count; i++) {
+        triangle_lightmap_uv(s->triangles[i], left, bottom, width, height);
+    }
+
+    add_surface(bake, SURFACE_FLOOR, s, NULL, NULL, s->floor_lightmap);
+    add_surface(bake, SURFACE_CEILING, s, NULL, NULL, s->ceiling_lightmap);
+}
+
+static bool line_blocks(Line *ld, float x, float y, float z, float lx, float ly, float lz) {
+    float rx = lx - x;
+    float rz = lz - z;
+    float sx = ld->b->x - ld->a->x;
+    float sz = ld->b->y - ld->a->y;
+
+    float denominator = rx * sz - rz * sx;
+    if (FLOAT_ZERO(denominator)) {
+        return false;
+    }
+
+    float qx = ld->a->x - x;
+    float qz = ld->a->y - z;
+
+    float t = (qx * sz - qz * sx) / denominator;
+    float u = (qx * rz - qz * rx) / denominator;
+
+    if (t <= 0.0f or t >= 1.0f or u < 0.0f or u > 1.0f) {
+        return false;
+    }
+
+    if (ld->middle != NULL or ld->plus == NULL or ld->minus == NULL) {
+        return true;
+    }
+
+    float height = y + (ly - y) * t;
+    float low = fmaxf(ld->plus->floor, ld->minus->floor);
+    float high = fminf(ld->plus->ceiling, ld->minus->ceiling);
+
+    return height < low or height > high;
+}
+
+static bool visible(World *world, Line *ignore, float x, float y, float z, Light *light) {
+    int c_min = (int)fminf(x, light->x) >> WORLD_CELL_SHIFT;
+    int c_max = (int)fmaxf(x, light->x) >> WORLD_CELL_SHIFT;
+    int r_min = (int)fminf(z, light->z) >> WORLD_CELL_SHIFT;
+    int r_max = (int)fmaxf(z, light->z) >> WORLD_CELL_SHIFT;
+
+    if (c_min < 0) {
+        c_min = 0;
+    }
+    if (r_min < 0) {
+        r_min = 0;
+    }
+    if (c_max >= world->columns) {
+        c_max = world->columns - 1;
+    }
+    if (r_max >= world->rows) {
+        r_max = world->rows - 1;
+    }
+
+    for (int r = r_min; r <= r_max; r++) {
+        for (int c = c_min; c <= c_max; c++) {
+            Cell *cell = &world->cells[c + r * world->columns];
+            for (int i = 0; i < cell->line_count; i++) {
+                Line *ld = cell->lines[i];
+                if (ld != ignore and line_blocks(ld, x, y, z, light->x, light->y, light->z)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static float illuminate(Bake *bake, Line *ignore, float x, float y, float z, float nx, float ny, float nz, bool two_sided) {
+    float total = 0.0f;
+    for (int i = 0; i < bake->light_count; i++) {
+        Light *light = bake->lights[i];
+        float contribution = light_sample(light, x, y, z);
+        if (contribution <= 0.0f) {
+            continue;
+        }
+
+        float dx = light->x - x;
+        float dy = light->y - y;
+        float dz = light->z - z;
+        float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+        float lambert = 1.0f;
+        if (distance > FLOAT_PRECISION) {
+            lambert = (dx * nx + dy * ny + dz * nz) / distance;
+            if (two_sided) {
+                lambert = fabsf(lambert);
+            }
+        }
+        if (lambert <= 0.0f) {
+            continue;
+        }
+
+        if (visible(bake->world, ignore, x, y, z, light)) {
+            total += contribution * lambert;
+        }
+    }
+    return total;
+}
+
+static u8 texel(float light) {
+    if (light <= 0.0f) {
+        return 0;
+    }
+    if (light >= 1.0f) {
+        return 255;
+    }
+    return (u8)(light * 255.0f);
+}
+
+static void bake_flat(Bake *bake, Surface *surface) {
+    Sector *s = surface->sec;
+    Lightmap *map = surface->lightmap;
+
+    bool floor = surface->type == SURFACE_FLOOR;
+    float ny = floor ? 1.0f : -1.0f;
+
+    for (i32 j = 0; j < map->height; j++) {
+        float z = s->lightmap_z + ((float)j + 0.5f) * LIGHTMAP_TEXEL;
+        for (i32 i = 0; i < map->width; i++) {
+            float x = s->lightmap_x + ((float)i + 0.5f) * LIGHTMAP_TEXEL;
+            float y = floor ? sector_floor_at(s, x, z) : sector_ceiling_at(s, x, z);
+            float light = s->light + illuminate(bake, NULL, x, y, z, 0.0f, ny, 0.0f, false);
+            map->texels[i + j * map->width] = texel(light);
+        }
+    }
+}
+
+static void bake_wall(Bake *bake, Surface *surface) {
+    Line *ld = surface->line;
+    Wall *wall = surface->wall;
+    Lightmap *map = surface->lightmap;
+
+    float ambient = SECTOR_DEFAULT_LIGHT;
+    if (ld->minus != NULL) {
+        ambient = ld->minus->light;
+    } else if (ld->plus != NULL) {
+        ambient = ld->plus->light;
+    }
+
+    float ax = wall->a->x;
+    float az = wall->a->y;
+    float vx = wall->b->x - ax;
+    float vz = wall->b->y - az;
+
+    for (i32 j = 0; j < map->height; j++) {
+        float v = ((float)j + 0.5f) / (float)map->height;
+        for (i32 i = 0; i < map->width; i++) {
+            float u = ((float)i + 0.5f) / (float)map->width;
+            float x = ax + vx * u;
+            float z = az + vz * u;
+            float floor = wall->floor + (wall->floor_b - wall->floor) * u;
+            float ceiling = wall->ceiling + (wall->ceiling_b - wall->ceiling) * u;
+            float y = floor + (ceiling - floor) * v;
+            float light = ambient + illuminate(bake, ld, x, y, z, ld->normal.x, 0.0f, ld->normal.y, true);
+            map->texels[i + j * map->width] = texel(light);
+        }
+    }
+}
+
+static void bake_task(void *context, int job, int worker) {
+    (void)worker;
+    Bake *bake = context;
+    Surface *surface = &bake->surfaces[job];
+    if (surface->type == SURFACE_WALL) {
+        bake_wall(bake, surface);
+    } else {
+        bake_flat(bake, surface);
+    }
+}
+
+static bool cache_path(World *world, char *out, usize size, u64 hash) {
+    if (world->cache == NULL) {
+        return false;
+    }
+    int length = snprintf(out, size, "%slightmap-%016llx.cache", world->cache, (unsigned long long)hash);
+    return length > 0 and (usize)length < size;
+}
+
+static bool cache_load(Bake *bake, u64 hash) {
+    char path[BAKE_CACHE_PATH];
+    if (!cache_path(bake->world, path, sizeof(path), hash)) {
+        return false;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    u32 magic = 0;
+    u32 version = 0;
+    u64 stored = 0;
+    i32 count = 0;
+
+    bool ok = fread(&magic, sizeof(u32), 1, fp) == 1 and fread(&version, sizeof(u32), 1, fp) == 1 and fread(&stored, sizeof(u64), 1, fp) == 1 and fread(&count, sizeof(i32), 1, fp) == 1;
+    ok = ok and magic == BAKE_CACHE_MAGIC and version == BAKE_CACHE_VERSION and stored == hash and count == bake->surface_count;
+
+    for (int i = 0; ok and i < bake->surface_count; i++) {
+        Lightmap *map = bake->surfaces[i].lightmap;
+        i32 size[2];
+        ok = fread(size, sizeof(i32), 2, fp) == 2 and size[0] == map->width and size[1] == map->height;
+        ok = ok and fread(map->texels, sizeof(u8), map->width * map->height, fp) == (usize)(map->width * map->height);
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+static void cache_save(Bake *bake, u64 hash) {
+    char path[BAKE_CACHE_PATH];
+    if (!cache_path(bake->world, path, sizeof(path), hash)) {
+        return;
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return;
+    }
+
+    u32 magic = BAKE_CACHE_MAGIC;
+    u32 version = BAKE_CACHE_VERSION;
+    i32 count = bake->surface_count;
+
+    fwrite(&magic, sizeof(u32), 1, fp);
+    fwrite(&version, sizeof(u32), 1, fp);
+    fwrite(&hash, sizeof(u64), 1, fp);
+    fwrite(&count, sizeof(i32), 1, fp);
+
+    for (int i = 0; i < bake->surface_count; i++) {
+        Lightmap *map = bake->surfaces[i].lightmap;
+        i32 size[2] = {map->width, map->height};
+        fwrite(size, sizeof(i32), 2, fp);
+        fwrite(map->texels, sizeof(u8), map->width * map->height, fp);
+    }
+
+    fclose(fp);
+}
+
+static void bake_init(Bake *bake, World *world) {
+    bake->world = world;
+    bake->lights = safe_malloc((world->light_count + 1) * sizeof(Light *));
+    for (int i = 0; i < world->light_count; i++) {
+        if (world->lights[i]->is_static) {
+            bake->lights[bake->light_count] = world->lights[i];
+            bake->light_count++;
+        }
+    }
+}
+
+void world_bake_lightmaps(World *this) {
+    Bake bake = {0};
+    bake_init(&bake, this);
+
+    for (int i = 0; i < this->sector_count; i++) {
+        add_sector(&bake, this->sectors[i]);
+    }
+
+    for (int i = 0; i < this->line_count; i++) {
+        Line *ld = this->lines[i];
+        add_wall(&bake, ld, ld->bottom);
+        add_wall(&bake, ld, ld->middle);
+        add_wall(&bake, ld, ld->top);
+    }
+
+    if (bake.light_count == 0) {
+        worker_pool_run(this->workers, bake_task, &bake, bake.surface_count);
+    } else {
+        u64 hash = world_hash(this, &bake);
+        if (!cache_load(&bake, hash)) {
+            worker_pool_run(this->workers, bake_task, &bake, bake.surface_count);
+            cache_save(&bake, hash);
+        }
+    }
+
+    for (int i = 0; i < this->rebake_count; i++) {
+        this->rebake[i]->lightmap_dirty = false;
+    }
+    this->rebake_count = 0;
+
+    free(bake.lights);
+    free(bake.surfaces);
+}
+
+void world_rebake_lightmaps(World *this) {
+    if (this->rebake_count == 0) {
+        return;
+    }
+
+    Bake bake = {0};
+    bake_init(&bake, this);
+
+    for (int i = 0; i < this->rebake_count; i++) {
+        Sector *s = this->rebake[i];
+        s->lightmap_dirty = false;
+        add_surface(&bake, SURFACE_FLOOR, s, NULL, NULL, s->floor_lightmap);
+        add_surface(&bake, SURFACE_CEILING, s, NULL, NULL, s->ceiling_lightmap);
+        for (int k = 0; k < s->line_count; k++) {
+            Line *ld = s->lines[k];
+            if (!has_line(&bake, ld)) {
+                add_wall(&bake, ld, ld->bottom);
+                add_wall(&bake, ld, ld->middle);
+                add_wall(&bake, ld, ld->top);
+            }
+        }
+    }
+    this->rebake_count = 0;
+
+    worker_pool_run(this->workers, bake_task, &bake, bake.surface_count);
+
+    free(bake.lights);
+    free(bake.surfaces);
+}
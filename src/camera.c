@@ -17,7 +17,10 @@ void camera_update(Camera *this) {
     float sin_y = sinf(this->ry);
     float cos_y = cosf(this->ry);
 
-    this->x = this->target->x - this->radius * cos_x * sin_y;
-    this->y = this->target->y + this->radius * sin_x + this->target->height;
-    this->z = this->target->z + this->radius * cos_x * cos_y;
+    ThingStore *store = &this->target->map->store;
+    int i = this->target->index;
+
+    this->x = store->x[i] - this->radius * cos_x * sin_y;
+    this->y = store->y[i] + this->radius * sin_x + store->height[i];
+    this->z = store->z[i] + this->radius * cos_x * cos_y;
 }
@@ -8,6 +8,21 @@ u32 rgb(u8 r, u8 g, u8 b) {
     return ((u32)r << 16) | ((u32)g << 8) | (u32)b;
 }
 
+u32 blend(u32 dst, u32 src, i32 alpha) {
+    u32 a = (u32)alpha;
+    u32 b = 256 - a;
+    u32 rb = (((src & 0xff00ff) * a + (dst & 0xff00ff) * b) >> 8) & 0xff00ff;
+    u32 g = (((src & 0x00ff00) * a + (dst & 0x00ff00) * b) >> 8) & 0x00ff00;
+    return rb | g;
+}
+
+u32 shade(u32 color, i32 level) {
+    u32 l = (u32)level;
+    u32 rb = (((color & 0xff00ff) * l) >> 8) & 0xff00ff;
+    u32 g = (((color & 0x00ff00) * l) >> 8) & 0x00ff00;
+    return rb | g;
+}
+
 i32 orient(i32 x0, i32 y0, i32 x1, i32 y1, i32 x2, i32 y2) {
     return (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
 }
@@ -38,7 +53,11 @@ void canvas_clear_color(Canvas *this) {
 }
 
 void canvas_clear_depth(Canvas *this) {
-    memset(this->depth, INT_MAX, this->width * this->height * sizeof(float));
+    float *depth = this->depth;
+    i32 size = this->width * this->height;
+    for (i32 i = 0; i < size; i++) {
+        depth[i] = FLT_MAX;
+    }
 }
 
 void canvas_pixel(Canvas *this, u32 color, i32 x, i32 y) {
@@ -48,42 +67,179 @@ void canvas_pixel(Canvas *this, u32 color, i32 x, i32 y) {
     }
 }
 
-void canvas_line(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1) {
-    i32 width = this->width;
-    i32 height = this->height;
-    u32 *pixels = this->pixels;
+enum Outcode {
+    OUTCODE_INSIDE = 0,
+    OUTCODE_LEFT = 1,
+    OUTCODE_RIGHT = 2,
+    OUTCODE_BOTTOM = 4,
+    OUTCODE_TOP = 8,
+};
+
+static int outcode(float x, float y, float right, float bottom) {
+    int code = OUTCODE_INSIDE;
+    if (x < 0.0f) {
+        code |= OUTCODE_LEFT;
+    } else if (x > right) {
+        code |= OUTCODE_RIGHT;
+    }
+    if (y < 0.0f) {
+        code |= OUTCODE_TOP;
+    } else if (y > bottom) {
+        code |= OUTCODE_BOTTOM;
+    }
+    return code;
+}
 
-    i32 dx = abs32(x1 - x0);
-    i32 sx = (x0 < x1) ? 1 : -1;
-    i32 dy = abs32(y1 - y0);
-    i32 sy = (y0 < y1) ? 1 : -1;
-    i32 err = ((dx > dy) ? dx : -dy) / 2;
-    i32 err2;
-    i32 x = x0;
-    i32 y = y0;
+bool canvas_clip_line(Canvas *this, float *x0, float *y0, float *x1, float *y1) {
+    float right = (float)(this->width - 1);
+    float bottom = (float)(this->height - 1);
+
+    int code0 = outcode(*x0, *y0, right, bottom);
+    int code1 = outcode(*x1, *y1, right, bottom);
 
     while (true) {
-        if (x < 0 or y < 0) {
-            return;
+        if ((code0 | code1) == 0) {
+            return true;
         }
-        i32 px = x;
-        i32 py = y;
-        if (px >= width or py >= height) {
-            return;
+        if (code0 & code1) {
+            return false;
         }
-        pixels[px + py * width] = color;
-        if (x == x1 and y == y1) {
-            break;
+
+        int out = code0 ? code0 : code1;
+        float x;
+        float y;
+
+        if (out & OUTCODE_TOP) {
+            x = *x0 + (*x1 - *x0) * (0.0f - *y0) / (*y1 - *y0);
+            y = 0.0f;
+        } else if (out & OUTCODE_BOTTOM) {
+            x = *x0 + (*x1 - *x0) * (bottom - *y0) / (*y1 - *y0);
+            y = bottom;
+        } else if (out & OUTCODE_LEFT) {
+            y = *y0 + (*y1 - *y0) * (0.0f - *x0) / (*x1 - *x0);
+            x = 0.0f;
+        } else {
+            y = *y0 + (*y1 - *y0) * (right - *x0) / (*x1 - *x0);
+            x = right;
         }
-        err2 = err;
-        if (err2 > -dx) {
-            err -= dy;
-            x += sx;
+
+        if (out == code0) {
+            *x0 = x;
+            *y0 = y;
+            code0 = outcode(x, y, right, bottom);
+        } else {
+            *x1 = x;
+            *y1 = y;
+            code1 = outcode(x, y, right, bottom);
         }
-        if (err2 < dy) {
-            err += dx;
-            y += sy;
+    }
+}
+
+void canvas_line(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1) {
+    i32 width = this->width;
+
+    float fx0 = (float)x0;
+    float fy0 = (float)y0;
+    float fx1 = (float)x1;
+    float fy1 = (float)y1;
+
+    if (!canvas_clip_line(this, &fx0, &fy0, &fx1, &fy1)) {
+        return;
+    }
+
+    x0 = (i32)lroundf(fx0);
+    y0 = (i32)lroundf(fy0);
+    x1 = (i32)lroundf(fx1);
+    y1 = (i32)lroundf(fy1);
+
+    i32 dx = abs32(x1 - x0);
+    i32 dy = abs32(y1 - y0);
+    i32 sx = (x0 < x1) ? 1 : -1;
+    i32 sy = (y0 < y1) ? width : -width;
+
+    i32 major;
+    i32 minor;
+    i32 step_major;
+    i32 step_minor;
+
+    if (dx >= dy) {
+        major = dx;
+        minor = dy;
+        step_major = sx;
+        step_minor = sy;
+    } else {
+        major = dy;
+        minor = dx;
+        step_major = sy;
+        step_minor = sx;
+    }
+
+    u32 *out = &this->pixels[x0 + y0 * width];
+    i32 err = 2 * minor - major;
+    i32 up = 2 * minor;
+    i32 down = 2 * major;
+
+    for (i32 i = 0; i <= major; i++) {
+        *out = color;
+        i32 mask = -(i32)(err > 0);
+        out += step_major + (step_minor & mask);
+        err += up - (down & mask);
+    }
+}
+
+static void plot_smooth(Canvas *this, u32 color, i32 x, i32 y, float coverage) {
+    if (x < 0 or y < 0 or x >= this->width or y >= this->height) {
+        return;
+    }
+    u32 *out = &this->pixels[x + y * this->width];
+    *out = blend(*out, color, (i32)(coverage * 256.0f));
+}
+
+void canvas_line_smooth(Canvas *this, u32 color, float x0, float y0, float x1, float y1) {
+    if (!canvas_clip_line(this, &x0, &y0, &x1, &y1)) {
+        return;
+    }
+
+    bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+    float temp;
+
+    if (steep) {
+        temp = x0;
+        x0 = y0;
+        y0 = temp;
+        temp = x1;
+        x1 = y1;
+        y1 = temp;
+    }
+
+    if (x0 > x1) {
+        temp = x0;
+        x0 = x1;
+        x1 = temp;
+        temp = y0;
+        y0 = y1;
+        y1 = temp;
+    }
+
+    float dx = x1 - x0;
+    float gradient = (dx == 0.0f) ? 1.0f : (y1 - y0) / dx;
+
+    i32 start = (i32)floorf(x0 + 0.5f);
+    i32 end = (i32)floorf(x1 + 0.5f);
+    float y = y0 + gradient * ((float)start - x0);
+
+    for (i32 x = start; x <= end; x++) {
+        float base = floorf(y);
+        float fraction = y - base;
+        i32 py = (i32)base;
+        if (steep) {
+            plot_smooth(this, color, py, x, 1.0f - fraction);
+            plot_smooth(this, color, py + 1, x, fraction);
+        } else {
+            plot_smooth(this, color, x, py, 1.0f - fraction);
+            plot_smooth(this, color, x, py + 1, fraction);
         }
+        y += gradient;
     }
 }
 
@@ -109,6 +265,17 @@ void canvas_triangle(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1, i3
     }
 }
 
+static void span_fill(u32 *out, u32 color, i32 count) {
+    u32 low = color & 0xff;
+    if (color == (low | (low << 8) | (low << 16) | (low << 24))) {
+        memset(out, (int)low, count * sizeof(u32));
+        return;
+    }
+    for (i32 i = 0; i < count; i++) {
+        out[i] = color;
+    }
+}
+
 void canvas_rect(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1) {
     i32 width = this->width;
     i32 height = this->height;
@@ -116,16 +283,243 @@ void canvas_rect(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1) {
 
     i32 min_x = max32(min32(x0, x1), 0);
     i32 min_y = max32(min32(y0, y1), 0);
-    i32 max_x = min32(max32(x0, x1), width - 1);
-    i32 max_y = min32(max32(y0, y1), height - 1);
+    i32 max_x = min32(max32(x0, x1), width);
+    i32 max_y = min32(max32(y0, y1), height);
 
-    for (i32 y = min_y; y < max_y; y++) {
-        for (i32 x = min_x; x < max_x; x++) {
-            pixels[x + y * width] = color;
+    if (min_x >= max_x or min_y >= max_y) {
+        return;
+    }
+
+    i32 span = max_x - min_x;
+    u32 *first = &pixels[min_x + min_y * width];
+    span_fill(first, color, span);
+
+    usize bytes = span * sizeof(u32);
+    for (i32 y = min_y + 1; y < max_y; y++) {
+        memcpy(&pixels[min_x + y * width], first, bytes);
+    }
+}
+
+void canvas_paint(Canvas *this, Paint *paint, i32 x, i32 y) {
+    i32 width = this->width;
+    i32 height = this->height;
+    u32 *pixels = this->pixels;
+
+    if (x >= width or y >= height or x + paint->width <= 0 or y + paint->height <= 0) {
+        return;
+    }
+
+    u32 *colors = paint->colors;
+    i32 stride = paint->width;
+    PaintSpan *spans = paint->spans;
+    i32 count = paint->span_count;
+
+    if (x >= 0 and y >= 0 and x + paint->width <= width and y + paint->height <= height) {
+        for (i32 i = 0; i < count; i++) {
+            PaintSpan *s = &spans[i];
+            memcpy(&pixels[x + s->x + (y + s->y) * width], &colors[s->x + s->y * stride], s->length * sizeof(u32));
         }
+        return;
+    }
+
+    for (i32 i = 0; i < count; i++) {
+        PaintSpan *s = &spans[i];
+        i32 py = y + s->y;
+        if (py < 0 or py >= height) {
+            continue;
+        }
+        i32 start = max32(x + s->x, 0);
+        i32 end = min32(x + s->x + s->length, width);
+        if (start >= end) {
+            continue;
+        }
+        memcpy(&pixels[start + py * width], &colors[start - x + s->y * stride], (end - start) * sizeof(u32));
     }
 }
 
+static void glyph_clipped(Canvas *this, PaintSpan *spans, i32 count, u32 color, i32 x, i32 y) {
+    i32 width = this->width;
+    i32 height = this->height;
+    u32 *pixels = this->pixels;
+    for (i32 i = 0; i < count; i++) {
+        PaintSpan *s = &spans[i];
+        i32 py = y + s->y;
+        if (py < 0 or py >= height) {
+            continue;
+        }
+        i32 start = max32(x + s->x, 0);
+        i32 end = min32(x + s->x + s->length, width);
+        if (start < end) {
+            span_fill(&pixels[start + py * width], color, end - start);
+        }
+    }
+}
+
+void canvas_text(Canvas *this, Font *font, u32 color, i32 x, i32 y, char *text) {
+    i32 width = this->width;
+    i32 height = this->height;
+    u32 *pixels = this->pixels;
+
+    i32 glyph_width = font->glyph_width;
+    i32 glyph_height = font->glyph_height;
+
+    i32 left = x;
+
+    for (char *c = text; *c != '\0'; c++) {
+        u8 code = (u8)*c;
+
+        if (code == '\n') {
+            x = left;
+            y += glyph_height;
+            continue;
+        }
+
+        if (code < FONT_GLYPH_COUNT) {
+            Glyph *glyph = &font->glyphs[code];
+            PaintSpan *spans = &font->spans[glyph->span_start];
+            i32 count = glyph->span_count;
+
+            if (x >= 0 and y >= 0 and x + glyph_width <= width and y + glyph_height <= height) {
+                u32 *origin = &pixels[x + y * width];
+                for (i32 i = 0; i < count; i++) {
+                    PaintSpan *s = &spans[i];
+                    u32 *out = &origin[s->x + s->y * width];
+                    for (i32 k = 0; k < s->length; k++) {
+                        out[k] = color;
+                    }
+                }
+            } else if (x < width and y < height and x + glyph_width > 0 and y + glyph_height > 0) {
+                glyph_clipped(this, spans, count, color, x, y);
+            }
+        }
+
+        x += glyph_width;
+    }
+}
+
+static i32 light_level(float light) {
+    if (light <= 0.0f) {
+        return 0;
+    }
+    if (light >= 1.0f) {
+        return 256;
+    }
+    return (i32)(light * 256.0f);
+}
+
+static u32 surface_texel(CanvasSurface *surface, float u, float v) {
+    Paint *paint = surface->paint;
+    if (paint == NULL or paint->colors == NULL) {
+        return surface->color;
+    }
+    i32 width = paint->width;
+    i32 height = paint->height;
+    i32 x = (i32)floorf(u * (float)width) % width;
+    i32 y = (i32)floorf(v * (float)height) % height;
+    if (x < 0) {
+        x += width;
+    }
+    if (y < 0) {
+        y += height;
+    }
+    return paint->colors[x + y * width];
+}
+
+static void shade_run(Canvas *this, CanvasSurface *surface, i32 index, i32 stride, i32 count, CanvasVertex *from, CanvasVertex *step) {
+    u32 *pixels = this->pixels;
+    float *depth = this->depth;
+
+    float w = from->w;
+    float u = from->u;
+    float v = from->v;
+    float s = from->s;
+    float t = from->t;
+    float light = from->light;
+
+    Lightmap *lightmap = surface->lightmap;
+
+    Paint *paint = surface->paint;
+    u32 *colors = paint != NULL ? paint->colors : NULL;
+    i32 width = colors != NULL ? paint->width : 0;
+    i32 height = colors != NULL ? paint->height : 0;
+    bool wrap = colors != NULL and (width & (width - 1)) == 0 and (height & (height - 1)) == 0;
+    u64 mask_x = (u64)width - 1;
+    u64 mask_y = (u64)height - 1;
+    float scale_u = (float)width * 65536.0f;
+    float scale_v = (float)height * 65536.0f;
+
+    for (i32 i = 0; i < count; i++) {
+        float z = 1.0f / w;
+        if (z < depth[index]) {
+            u32 color;
+            if (wrap) {
+                u64 x = ((u64)(i64)(u * z * scale_u) >> 16) & mask_x;
+                u64 y = ((u64)(i64)(v * z * scale_v) >> 16) & mask_y;
+                color = colors[x + y * (u64)width];
+            } else {
+                color = surface_texel(surface, u * z, v * z);
+            }
+            float level = lightmap != NULL ? light + lightmap_sample(lightmap, s * z, t * z) : light;
+            pixels[index] = shade(color, light_level(level));
+            depth[index] = z;
+        }
+        index += stride;
+        w += step->w;
+        u += step->u;
+        v += step->v;
+        s += step->s;
+        t += step->t;
+        light += step->light;
+    }
+}
+
+static void shade_line(Canvas *this, CanvasSurface *surface, i32 base, i32 stride, i32 limit, float start, float end, CanvasVertex *a, CanvasVertex *b) {
+    float length = end - start;
+    if (length <= 0.0f) {
+        return;
+    }
+
+    i32 first = max32((i32)ceilf(start - 0.5f), 0);
+    i32 last = min32((i32)ceilf(end - 0.5f), limit);
+    if (first >= last) {
+        return;
+    }
+
+    float inverse = 1.0f / length;
+    CanvasVertex step;
+    step.w = (b->w - a->w) * inverse;
+    step.u = (b->u - a->u) * inverse;
+    step.v = (b->v - a->v) * inverse;
+    step.s = (b->s - a->s) * inverse;
+    step.t = (b->t - a->t) * inverse;
+    step.light = (b->light - a->light) * inverse;
+
+    float offset = (float)first + 0.5f - start;
+    CanvasVertex from;
+    from.w = a->w + step.w * offset;
+    from.u = a->u + step.u * offset;
+    from.v = a->v + step.v * offset;
+    from.s = a->s + step.s * offset;
+    from.t = a->t + step.t * offset;
+    from.light = a->light + step.light * offset;
+
+    shade_run(this, surface, base + first * stride, stride, last - first, &from, &step);
+}
+
+void canvas_shade_span(Canvas *this, CanvasSurface *surface, i32 y, CanvasVertex *a, CanvasVertex *b) {
+    if (y < 0 or y >= this->height) {
+        return;
+    }
+    shade_line(this, surface, y * this->width, 1, this->width, a->x, b->x, a, b);
+}
+
+void canvas_shade_column(Canvas *this, CanvasSurface *surface, i32 x, CanvasVertex *a, CanvasVertex *b) {
+    if (x < 0 or x >= this->width) {
+        return;
+    }
+    shade_line(this, surface, x, this->width, this->height, a->y, b->y, a, b);
+}
+
 void canvas_project(Canvas *this, float *out, float *matrix, float *vec) {
 
     float x = vec[0] * matrix[0] + vec[1] * matrix[4] + vec[2] * matrix[8] + matrix[12];
@@ -213,3 +607,34 @@ char *canvas_rect_vm(Hymn *vm) {
     canvas_rect(canvas, color, x0, y0, x1, y1);
     return NULL;
 }
+
+char *canvas_paint_vm(Hymn *vm) {
+    Canvas *canvas = hymn_pointer(vm, 0);
+    Assets *assets = hymn_pointer(vm, 1);
+    String *name = hymn_string(vm, 2);
+    i32 x = hymn_i32(vm, 3);
+    i32 y = hymn_i32(vm, 4);
+    if (canvas == NULL or assets == NULL or name == NULL) {
+        return "paint: expected canvas, assets, name, x, y";
+    }
+    Paint *paint = assets_paint_find(assets, name);
+    if (paint == NULL) {
+        return "paint: unknown paint";
+    }
+    canvas_paint(canvas, paint, x, y);
+    return NULL;
+}
+
+char *canvas_text_vm(Hymn *vm) {
+    Canvas *canvas = hymn_pointer(vm, 0);
+    Font *font = hymn_pointer(vm, 1);
+    u32 color = hymn_u32(vm, 2);
+    i32 x = hymn_i32(vm, 3);
+    i32 y = hymn_i32(vm, 4);
+    String *text = hymn_string(vm, 5);
+    if (canvas == NULL or font == NULL or text == NULL) {
+        return "text: expected canvas, font, color, x, y, text";
+    }
+    canvas_text(canvas, font, color, x, y, text);
+    return NULL;
+}
@@ -5,16 +5,23 @@
 #ifndef CANVAS_H
 #define CANVAS_H
 
+#include <float.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <stdbool.h>
 
+#include "assets.h"
+#include "font.h"
 #include "hymn.h"
+#include "lightmap.h"
 #include "mem.h"
+#include "paint.h"
 #include "pie.h"
 #include "vec.h"
 
 typedef struct Canvas Canvas;
+typedef struct CanvasVertex CanvasVertex;
+typedef struct CanvasSurface CanvasSurface;
 
 struct Canvas {
     i32 width;
@@ -23,7 +30,26 @@ struct Canvas {
     float *depth;
 };
 
+struct CanvasVertex {
+    float x;
+    float y;
+    float w;
+    float u;
+    float v;
+    float s;
+    float t;
+    float light;
+};
+
+struct CanvasSurface {
+    Paint *paint;
+    u32 color;
+    Lightmap *lightmap;
+};
+
 u32 rgb(u8 r, u8 g, u8 b);
+u32 blend(u32 dst, u32 src, i32 alpha);
+u32 shade(u32 color, i32 level);
 i32 orient(i32 x0, i32 y0, i32 x1, i32 y1, i32 x2, i32 y2);
 
 i32 abs32(i32 i);
@@ -35,12 +61,20 @@ Canvas *new_canvas(i32 width, i32 height);
 void canvas_clear_color(Canvas *this);
 void canvas_clear_depth(Canvas *this);
 void canvas_pixel(Canvas *this, u32 color, i32 x, i32 y);
+bool canvas_clip_line(Canvas *this, float *x0, float *y0, float *x1, float *y1);
 void canvas_line(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1);
+void canvas_line_smooth(Canvas *this, u32 color, float x0, float y0, float x1, float y1);
 void canvas_triangle(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1, i32 x2, i32 y2);
 void canvas_rect(Canvas *this, u32 color, i32 x0, i32 y0, i32 x1, i32 y1);
+void canvas_paint(Canvas *this, Paint *paint, i32 x, i32 y);
+void canvas_text(Canvas *this, Font *font, u32 color, i32 x, i32 y, char *text);
+void canvas_shade_span(Canvas *this, CanvasSurface *surface, i32 y, CanvasVertex *a, CanvasVertex *b);
+void canvas_shade_column(Canvas *this, CanvasSurface *surface, i32 x, CanvasVertex *a, CanvasVertex *b);
 void canvas_project(Canvas *this, float *out, float *matrix, float *vec);
 void canvas_rasterize(Canvas *this, float *a, float *b, float *c);
 
 char *canvas_rect_vm(Hymn *vm);
+char *canvas_paint_vm(Hymn *vm);
+char *canvas_text_vm(Hymn *vm);
 
 #endif
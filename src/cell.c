@@ -25,64 +25,35 @@ void cell_add_line(Cell *this, Line *ld) {
     this->line_count++;
 }
 
-void cell_add_thing(Cell *this, Thing *t) {
-    if (this->thing_cap == 0) {
-        this->things = safe_malloc(sizeof(Thing *));
-        this->things[0] = t;
-        this->thing_cap = 1;
-        this->thing_count = 1;
-        return;
-    }
-
-    if (this->thing_count == this->thing_cap) {
-        this->thing_cap += 8;
-        this->things = safe_realloc(this->things, this->thing_cap * sizeof(Thing *));
-    }
-
-    this->things[this->thing_count] = t;
-    this->thing_count++;
+void cell_add_sector(Cell *this, Sector *s) {
+    this->sectors = safe_realloc(this->sectors, (this->sector_count + 1) * sizeof(Sector *));
+    this->sectors[this->sector_count] = s;
+    this->sector_count++;
 }
 
-void cell_remove_thing(Cell *this, Thing *t) {
-    int len = this->thing_count;
-    Thing **things = this->things;
-    for (int i = 0; i < len; i++) {
-        if (things[i] == t) {
-            things[i] = things[len - 1];
-            this->thing_count--;
-            return;
-        }
+void cell_add_thing(Cell *this, ThingStore *store, int index) {
+    int head = this->thing_head;
+    store->previous[index] = -1;
+    store->next[index] = head;
+    if (head != -1) {
+        store->previous[head] = index;
     }
+    this->thing_head = index;
+    this->thing_count++;
 }
 
-void cell_add_particle(Cell *this, Particle *t) {
-    if (this->particle_cap == 0) {
-        this->particles = safe_malloc(sizeof(Particle *));
-        this->particles[0] = t;
-        this->particle_cap = 1;
-        this->particle_count = 1;
-        return;
+void cell_remove_thing(Cell *this, ThingStore *store, int index) {
+    int previous = store->previous[index];
+    int next = store->next[index];
+    if (previous != -1) {
+        store->next[previous] = next;
+    } else {
+        this->thing_head = next;
     }
-
-    if (this->particle_count == this->particle_cap) {
-        this->particle_cap += 8;
-        this->particles = safe_realloc(this->particles, this->particle_cap * sizeof(Particle *));
-    }
-
-    this->particles[this->particle_count] = t;
-    this->particle_count++;
-}
-
-void cell_remove_particle(Cell *this, Particle *t) {
-    int len = this->particle_count;
-    Particle **particles = this->particles;
-    for (int i = 0; i < len; i++) {
-        if (particles[i] == t) {
-            particles[i] = particles[len - 1];
-            this->particle_count--;
-            return;
-        }
+    if (next != -1) {
+        store->previous[next] = previous;
     }
+    this->thing_count--;
 }
 
 void cell_add_decal(Cell *this, Decal *t) {
@@ -114,3 +85,63 @@ void cell_remove_decal(Cell *this, Decal *t) {
         }
     }
 }
+
+void cell_add_light(Cell *this, Light *t) {
+    if (this->light_cap == 0) {
+        this->lights = safe_malloc(sizeof(Light *));
+        this->lights[0] = t;
+        this->light_cap = 1;
+        this->light_count = 1;
+        return;
+    }
+
+    if (this->light_count == this->light_cap) {
+        this->light_cap += 8;
+        this->lights = safe_realloc(this->lights, this->light_cap * sizeof(Light *));
+    }
+
+    this->lights[this->light_count] = t;
+    this->light_count++;
+}
+
+void cell_remove_light(Cell *this, Light *t) {
+    int len = this->light_count;
+    Light **lights = this->lights;
+    for (int i = 0; i < len; i++) {
+        if (lights[i] == t) {
+            lights[i] = lights[len - 1];
+            this->light_count--;
+            return;
+        }
+    }
+}
+
+void cell_add_trigger(Cell *this, int trigger) {
+    if (this->trigger_cap == 0) {
+        this->triggers = safe_malloc(sizeof(int));
+        this->triggers[0] = trigger;
+        this->trigger_cap = 1;
+        this->trigger_count = 1;
+        return;
+    }
+
+    if (this->trigger_count == this->trigger_cap) {
+        this->trigger_cap += 8;
+        this->triggers = safe_realloc(this->triggers, this->trigger_cap * sizeof(int));
+    }
+
+    this->triggers[this->trigger_count] = trigger;
+    this->trigger_count++;
+}
+
+void cell_remove_trigger(Cell *this, int trigger) {
+    int len = this->trigger_count;
+    int *triggers = this->triggers;
+    for (int i = 0; i < len; i++) {
+        if (triggers[i] == trigger) {
+            triggers[i] = triggers[len - 1];
+            this->trigger_count--;
+            return;
+        }
+    }
+}
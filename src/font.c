@@ -0,0 +1,78 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "font.h"
+
+Font *new_font(Paint *paint, char *characters, i32 glyph_width, i32 glyph_height) {
+    Font *this = safe_calloc(1, sizeof(Font));
+    this->glyph_width = glyph_width;
+    this->glyph_height = glyph_height;
+
+    i32 per_row = paint->width / glyph_width;
+    i32 count = (i32)strlen(characters);
+
+    i32 cap = 0;
+
+    for (i32 i = 0; i < count; i++) {
+        u8 c = (u8)characters[i];
+        if (c >= FONT_GLYPH_COUNT) {
+            continue;
+        }
+
+        i32 left = (i % per_row) * glyph_width;
+        i32 top = (i / per_row) * glyph_height;
+        if (top + glyph_height > paint->height) {
+            break;
+        }
+
+        Glyph *glyph = &this->glyphs[c];
+        glyph->span_start = this->span_count;
+
+        for (i32 y = 0; y < glyph_height; y++) {
+            u8 *row = &paint->pixels[left + (top + y) * paint->width];
+            i32 x = 0;
+            while (x < glyph_width) {
+                if (row[x] == PAINT_TRANSPARENT) {
+                    x++;
+                    continue;
+                }
+                i32 start = x;
+                while (x < glyph_width and row[x] != PAINT_TRANSPARENT) {
+                    x++;
+                }
+                if (this->span_count == cap) {
+                    cap += 128;
+                    this->spans = safe_realloc(this->spans, cap * sizeof(PaintSpan));
+                }
+                this->spans[this->span_count] = (PaintSpan){start, y, x - start};
+                this->span_count++;
+            }
+        }
+
+        glyph->span_count = this->span_count - glyph->span_start;
+    }
+
+    return this;
+}
+
+i32 font_text_width(Font *this, char *text) {
+    i32 width = 0;
+    i32 line = 0;
+    for (char *c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            line = 0;
+            continue;
+        }
+        line += this->glyph_width;
+        if (line > width) {
+            width = line;
+        }
+    }
+    return width;
+}
+
+void font_delete(Font *this) {
+    free(this->spans);
+    free(this);
+}
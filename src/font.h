@@ -0,0 +1,39 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef FONT_H
+#define FONT_H
+
+#include "mem.h"
+#include "paint.h"
+#include "pie.h"
+
+#define FONT_GLYPH_COUNT 128
+
+#define TIC_80_WIDE_FONT_WIDTH 6
+#define TIC_80_WIDE_FONT_HEIGHT 6
+#define TIC_80_WIDE_FONT_CHARACTERS "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
+
+typedef struct Glyph Glyph;
+typedef struct Font Font;
+
+struct Glyph {
+    i32 span_start;
+    i32 span_count;
+};
+
+struct Font {
+    i32 glyph_width;
+    i32 glyph_height;
+    Glyph glyphs[FONT_GLYPH_COUNT];
+    PaintSpan *spans;
+    i32 span_count;
+};
+
+Font *new_font(Paint *paint, char *characters, i32 glyph_width, i32 glyph_height);
+i32 font_text_width(Font *this, char *text);
+
+void font_delete(Font *this);
+
+#endif
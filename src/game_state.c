@@ -4,6 +4,8 @@
 
 #include "state.h"
 
+#define GAME_STATE_PATH 1024
+
 GameState *new_game_state(Canvas *canvas, Input *input, Assets *assets) {
     GameState *this = safe_calloc(1, sizeof(GameState));
     this->state.canvas = canvas;
@@ -11,15 +13,46 @@ GameState *new_game_state(Canvas *canvas, Input *input, Assets *assets) {
     this->state.assets = assets;
     this->state.update = game_state_update;
     this->state.draw = game_state_draw;
+    this->world = new_world();
     this->camera = new_camera(8.0);
     return this;
 }
 
+static Paint *load_paint(String *name) {
+    char path[GAME_STATE_PATH];
+    int length = snprintf(path, sizeof(path), "pack/paint/%s.wad", name);
+    FILE *fp = (length > 0 and (usize)length < sizeof(path)) ? fopen(path, "r") : NULL;
+    if (fp != NULL) {
+        fclose(fp);
+        String *content = cat(path);
+        MaybeWad parse = wad_parse(content);
+        string_delete(content);
+        if (parse.error == NULL) {
+            Paint *paint = paint_from_wad(parse.wad);
+            wad_delete(parse.wad);
+            return paint;
+        }
+        fprintf(stderr, "Failed to parse paint: %s: %s\n", path, parse.error);
+    }
+    u32 hash = 0;
+    for (usize i = 0; name[i] != '\0'; i++) {
+        hash = hash * 31 + (u8)name[i];
+    }
+    u8 a = (u8)(1 + hash % 15);
+    u8 b = (u8)(1 + (hash % 15 + 1 + (hash >> 4) % 14) % 15);
+    return paint_checker(8, a, b);
+}
+
 static int texture(Assets *assets, String *name) {
-    if (strcmp(name, "none")) {
+    if (strcmp(name, "none") == 0) {
         return -1;
     }
-    return assets_paint_name_to_index(assets, name);
+    int index = assets_paint_name_to_index(assets, name);
+    if (index == -1) {
+        index = assets->paint_count;
+        assets_paint_save(assets, name, load_paint(name));
+    }
+    return index;
 }
 
 void game_state_open(GameState *this, String *content) {
@@ -57,7 +90,7 @@ void game_state_open(GameState *this, String *content) {
         int e = wad_get_int(wad_get_from_object(line, "e"));
         Vec *a = array_get(vecs, s);
         Vec *b = array_get(vecs, e);
-        array_push(vecs, new_line(a, b, LINE_NO_WALL, LINE_NO_WALL, LINE_NO_WALL));
+        array_push(lines, new_line(a, b, LINE_NO_WALL, LINE_NO_WALL, LINE_NO_WALL));
     }
 
     for (usize i = 0; i < map_sectors->length; i++) {
@@ -80,7 +113,25 @@ void game_state_open(GameState *this, String *content) {
         for (int d = 0; d < line_count; d++) {
             sector_lines[d] = array_get(lines, wad_get_int((Wad *)line_ptrs->items[d]));
         }
-        world_add_sector(world, new_sector(sector_vecs, vec_count, sector_lines, line_count, bottom, floor, ceiling, top, floor_paint, ceiling_paint));
+        Sector *s = new_sector(sector_vecs, vec_count, sector_lines, line_count, bottom, floor, ceiling, top, floor_paint, ceiling_paint);
+        Wad *light = wad_get_from_object(sector, "l");
+        if (light != NULL) {
+            s->light = wad_get_float(light);
+        }
+        world_add_sector(world, s);
+    }
+
+    WadArray *map_lights = wad_get_array_from_object(wad, "lights");
+    if (map_lights != NULL) {
+        for (usize i = 0; i < map_lights->length; i++) {
+            Wad *light = ((Wad *)map_lights->items[i]);
+            float x = wad_get_float(wad_get_from_object(light, "x"));
+            float y = wad_get_float(wad_get_from_object(light, "y"));
+            float z = wad_get_float(wad_get_from_object(light, "z"));
+            float radius = wad_get_float(wad_get_from_object(light, "r"));
+            float intensity = wad_get_float(wad_get_from_object(light, "i"));
+            new_static_light(world, x, y, z, radius, intensity);
+        }
     }
 
     world_build(world, lines);
@@ -89,12 +140,83 @@ void game_state_open(GameState *this, String *content) {
     wad_delete(wad);
 }
 
+static bool replay_file(GameState *this, char *out, usize size) {
+    if (this->replay_path == NULL) {
+        return false;
+    }
+    int length = snprintf(out, size, "%sreplay.bin", this->replay_path);
+    return length > 0 and (usize)length < size;
+}
+
+void game_state_record(GameState *this) {
+    if (this->recording) {
+        char path[GAME_STATE_PATH];
+        if (replay_file(this, path, sizeof(path)) and !replay_save(this->replay, path)) {
+            fprintf(stderr, "Failed to save replay: %s\n", path);
+        }
+        this->recording = false;
+        return;
+    }
+    if (this->replay != NULL) {
+        replay_delete(this->replay);
+    }
+    this->replay = new_replay(this->world);
+    this->recording = true;
+    this->replaying = false;
+}
+
+void game_state_play(GameState *this) {
+    if (this->recording) {
+        game_state_record(this);
+    }
+    char path[GAME_STATE_PATH];
+    if (replay_file(this, path, sizeof(path))) {
+        Replay *loaded = replay_load(path);
+        if (loaded != NULL) {
+            if (this->replay != NULL) {
+                replay_delete(this->replay);
+            }
+            this->replay = loaded;
+        }
+    }
+    if (this->replay == NULL or !replay_begin(this->replay, this->world)) {
+        return;
+    }
+    this->replaying = true;
+}
+
 void game_state_update(void *state) {
     GameState *this = (GameState *)state;
 
     Input *input = this->state.input;
     Camera *camera = this->camera;
 
+    if (input->record) {
+        input->record = false;
+        game_state_record(this);
+    }
+
+    if (input->play) {
+        input->play = false;
+        game_state_play(this);
+    }
+
+    Replay *replay = this->replay;
+
+    u64 expected = 0;
+    if (this->replaying and !replay_next(replay, input, &expected)) {
+        this->replaying = false;
+        fprintf(stderr, "Replay finished with %d desyncs\n", replay->desyncs);
+    }
+    Input recorded = *input;
+
+    if (input->debug) {
+        input->debug = false;
+        this->overlay = (this->overlay + 1) % OVERLAY_MODE_COUNT;
+    }
+
+    this->world->focus = camera->target;
+
     if (input->move_up) {
         camera->x += 0.1f;
     }
@@ -118,6 +240,16 @@ void game_state_update(void *state) {
     if (input->look_right) {
         camera->ry -= 0.1f;
     }
+
+    world_update(this->world);
+
+    if (this->replaying) {
+        if (world_state_hash(this->world) != expected) {
+            replay->desyncs++;
+        }
+    } else if (this->recording) {
+        replay_record(replay, &recorded, world_state_hash(this->world));
+    }
 }
 
 void game_state_draw(void *state) {
@@ -126,8 +258,6 @@ void game_state_draw(void *state) {
     Canvas *canvas = this->state.canvas;
     Camera *camera = this->camera;
 
-    canvas_rect(canvas, rgb(255, 255, 0), 10, 60, 42, 92);
-
     canvas_clear_depth(canvas);
 
     float perspective[16];
@@ -150,133 +280,16 @@ void game_state_draw(void *state) {
     matrix_translate(view, -camera->x, -camera->y, -camera->z);
     matrix_multiply(projection, perspective, view);
 
-    i32 vertex_stride = 8;
-    // i32 vertex_count = 8;
-    float mesh[] = {
-        -1,
-        +1,
-        +1,
-        0,
-        255,
-        0,
-        0,
-        0,
-        +1,
-        +1,
-        +1,
-        255,
-        255,
-        0,
-        1,
-        0,
-        -1,
-        -1,
-        +1,
-        0,
-        255,
-        255,
-        0,
-        1,
-        +1,
-        -1,
-        +1,
-        255,
-        0,
-        0,
-        1,
-        1,
-        -1,
-        +1,
-        -1,
-        255,
-        0,
-        255,
-        0,
-        0,
-        +1,
-        +1,
-        -1,
-        0,
-        0,
-        255,
-        1,
-        0,
-        +1,
-        -1,
-        -1,
-        255,
-        0,
-        0,
-        1,
-        1,
-        -1,
-        -1,
-        -1,
-        0,
-        255,
-        0,
-        0,
-        1,
-    };
-
-    i32 index_count = 12;
-    i32 indices[] = {
-        0,
-        1,
-        2,
-        1,
-        2,
-        3,
-        1,
-        3,
-        6,
-        1,
-        5,
-        6,
-        0,
-        1,
-        4,
-        1,
-        4,
-        5,
-        2,
-        3,
-        7,
-        3,
-        6,
-        7,
-        0,
-        2,
-        7,
-        0,
-        4,
-        7,
-        4,
-        5,
-        6,
-        4,
-        6,
-        7,
-    };
-
-    float oa[4];
-    float ob[4];
-    float oc[4];
-
-    for (int i = 0; i < index_count; i += 3) {
-
-        float *a = &mesh[indices[i] * vertex_stride];
-        float *b = &mesh[indices[i + 1] * vertex_stride];
-        float *c = &mesh[indices[i + 2] * vertex_stride];
-
-        canvas_project(canvas, oa, projection, a);
-        canvas_project(canvas, ob, projection, b);
-        canvas_project(canvas, oc, projection, c);
-
-        canvas_rasterize(canvas, oa, ob, oc);
-    }
+    render_world(canvas, this->world, this->state.assets, projection);
+
+    overlay_draw(canvas, this->world, this->state.assets->font, this->overlay);
 }
 
 void game_state_delete(GameState *this) {
+    if (this->replay != NULL) {
+        replay_delete(this->replay);
+    }
+    world_delete(this->world);
+    free(this->camera);
     free(this);
 }
@@ -3808,6 +3808,17 @@ f64 hymn_f64(Hymn *this, i32 index) {
     return 0.0;
 }
 
+String *hymn_string(Hymn *this, i32 index) {
+    (void *)this;
+    (i32) index;
+    return NULL;
+}
+
+void hymn_push_i32(Hymn *this, i32 value) {
+    (void *)this;
+    (i32) value;
+}
+
 void hymn_delete(Hymn *this) {
     free(this);
 }
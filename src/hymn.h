@@ -48,6 +48,9 @@ i64 hymn_i64(Hymn *this, i32 index);
 u64 hymn_u64(Hymn *this, i32 index);
 f32 hymn_f32(Hymn *this, i32 index);
 f64 hymn_f64(Hymn *this, i32 index);
+String *hymn_string(Hymn *this, i32 index);
+
+void hymn_push_i32(Hymn *this, i32 value);
 
 void hymn_delete(Hymn *this);
 
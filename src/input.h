@@ -22,6 +22,9 @@ struct Input {
     bool look_left;
     bool look_right;
     bool console;
+    bool debug;
+    bool record;
+    bool play;
 };
 
 typedef struct Input Input;
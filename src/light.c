@@ -0,0 +1,115 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "world.h"
+
+float light_falloff[LIGHT_FALLOFF_STEPS];
+
+static bool light_falloff_ready = false;
+
+void light_falloff_init() {
+    if (light_falloff_ready) {
+        return;
+    }
+    for (int i = 0; i < LIGHT_FALLOFF_STEPS; i++) {
+        float t = 1.0f - sqrtf((float)i / (float)(LIGHT_FALLOFF_STEPS - 1));
+        light_falloff[i] = t * t;
+    }
+    light_falloff_ready = true;
+}
+
+static int clamp_cell(int value, int count) {
+    if (value < 0) {
+        return 0;
+    }
+    if (value >= count) {
+        return count - 1;
+    }
+    return value;
+}
+
+void light_add_to_cells(Light *this) {
+    World *map = this->map;
+    if (map->cell_count == 0 or this->is_static) {
+        this->c_min = 0;
+        this->c_max = -1;
+        this->r_min = 0;
+        this->r_max = -1;
+        return;
+    }
+
+    float radius = this->radius;
+    int c_min = clamp_cell((int)(this->x - radius) >> WORLD_CELL_SHIFT, map->columns);
+    int c_max = clamp_cell((int)(this->x + radius) >> WORLD_CELL_SHIFT, map->columns);
+    int r_min = clamp_cell((int)(this->z - radius) >> WORLD_CELL_SHIFT, map->rows);
+    int r_max = clamp_cell((int)(this->z + radius) >> WORLD_CELL_SHIFT, map->rows);
+
+    for (int r = r_min; r <= r_max; r++)
+        for (int c = c_min; c <= c_max; c++)
+            cell_add_light(&map->cells[c + r * map->columns], this);
+
+    this->c_min = c_min;
+    this->c_max = c_max;
+    this->r_min = r_min;
+    this->r_max = r_max;
+}
+
+void light_remove_from_cells(Light *this) {
+    World *map = this->map;
+    for (int r = this->r_min; r <= this->r_max; r++)
+        for (int c = this->c_min; c <= this->c_max; c++)
+            cell_remove_light(&map->cells[c + r * map->columns], this);
+}
+
+static Light *light_init(World *map, float x, float y, float z, float radius, float intensity, bool is_static) {
+    Light *this = safe_calloc(1, sizeof(Light));
+    this->map = map;
+    this->x = x;
+    this->y = y;
+    this->z = z;
+    this->radius = radius;
+    this->intensity = intensity;
+    this->is_static = is_static;
+    world_add_light(map, this);
+    return this;
+}
+
+Light *new_light(World *map, float x, float y, float z, float radius, float intensity) {
+    return light_init(map, x, y, z, radius, intensity, false);
+}
+
+Light *new_static_light(World *map, float x, float y, float z, float radius, float intensity) {
+    return light_init(map, x, y, z, radius, intensity, true);
+}
+
+void light_move(Light *this, float x, float y, float z) {
+    World *map = this->map;
+    float radius = this->radius;
+    int c_min = clamp_cell((int)(x - radius) >> WORLD_CELL_SHIFT, map->columns);
+    int c_max = clamp_cell((int)(x + radius) >> WORLD_CELL_SHIFT, map->columns);
+    int r_min = clamp_cell((int)(z - radius) >> WORLD_CELL_SHIFT, map->rows);
+    int r_max = clamp_cell((int)(z + radius) >> WORLD_CELL_SHIFT, map->rows);
+
+    bool same = c_min == this->c_min and c_max == this->c_max and r_min == this->r_min and r_max == this->r_max;
+
+    this->x = x;
+    this->y = y;
+    this->z = z;
+
+    if (!same) {
+        light_remove_from_cells(this);
+        light_add_to_cells(this);
+    }
+}
+
+float light_sample(Light *this, float x, float y, float z) {
+    float dx = x - this->x;
+    float dy = y - this->y;
+    float dz = z - this->z;
+    float distance = (dx * dx + dy * dy + dz * dz) / (this->radius * this->radius);
+    if (distance >= 1.0f) {
+        return 0.0f;
+    }
+    return this->intensity * light_falloff[(int)(distance * (float)(LIGHT_FALLOFF_STEPS - 1))];
+}
@@ -0,0 +1,40 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "lightmap.h"
+
+Lightmap *new_lightmap(float width, float height) {
+    Lightmap *this = safe_malloc(sizeof(Lightmap));
+    this->width = (i32)ceilf(width / LIGHTMAP_TEXEL);
+    this->height = (i32)ceilf(height / LIGHTMAP_TEXEL);
+    if (this->width < 1) {
+        this->width = 1;
+    }
+    if (this->height < 1) {
+        this->height = 1;
+    }
+    this->texels = safe_calloc(this->width * this->height, sizeof(u8));
+    return this;
+}
+
+float lightmap_sample(Lightmap *this, float s, float t) {
+    i32 x = (i32)(s * (float)this->width);
+    i32 y = (i32)(t * (float)this->height);
+    if (x < 0) {
+        x = 0;
+    } else if (x >= this->width) {
+        x = this->width - 1;
+    }
+    if (y < 0) {
+        y = 0;
+    } else if (y >= this->height) {
+        y = this->height - 1;
+    }
+    return (float)this->texels[x + y * this->width] * (1.0f / 255.0f);
+}
+
+void lightmap_delete(Lightmap *this) {
+    free(this->texels);
+    free(this);
+}
@@ -0,0 +1,27 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include <math.h>
+
+#include "mem.h"
+#include "pie.h"
+
+#define LIGHTMAP_TEXEL 4.0f
+
+typedef struct Lightmap Lightmap;
+
+struct Lightmap {
+    i32 width;
+    i32 height;
+    u8 *texels;
+};
+
+Lightmap *new_lightmap(float width, float height);
+float lightmap_sample(Lightmap *this, float s, float t);
+void lightmap_delete(Lightmap *this);
+
+#endif
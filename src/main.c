@@ -88,6 +88,9 @@ static void poll_events(Input *in) {
             case SDLK_LEFT: in->look_left = true; break;
             case SDLK_RIGHT: in->look_right = true; break;
             case SDLK_TAB: in->console = true; break;
+            case SDLK_F1: in->debug = true; break;
+            case SDLK_F5: in->record = true; break;
+            case SDLK_F6: in->play = true; break;
             }
             break;
         }
@@ -115,17 +118,21 @@ static void game_draw(Game *game) {
 
 static void game_load(Game *game) {
 
+    Assets *assets = game->game->state.assets;
+
     String *font_str = cat("pack/paint/tic_80_wide_font.wad");
     Wad *font_wad = wad_parse(font_str).wad;
+    Paint *font_paint = paint_from_wad(font_wad);
+    assets_paint_save(assets, "tic-80-wide-font", font_paint);
+    assets->font = new_font(font_paint, TIC_80_WIDE_FONT_CHARACTERS, TIC_80_WIDE_FONT_WIDTH, TIC_80_WIDE_FONT_HEIGHT);
+    hymn_add_pointer(game->vm, "font", assets->font);
     wad_delete(font_wad);
+    string_delete(font_str);
 
     String *map = cat("pack/maps/base.wad");
     game_state_open(game->game, map);
     string_delete(map);
 
-    Paint *font = new_paint();
-    paint_delete(font);
-
     game_call(game, "load");
 }
 
@@ -159,6 +166,9 @@ static void main_loop(Game *game) {
 
 static void game_delete(Game *game) {
     hymn_delete(game->vm);
+    game_state_delete(game->game);
+    paint_state_delete(game->paint);
+    worker_pool_delete(game->workers);
     free(game->win->canvas->pixels);
     free(game->win->canvas);
     free(game->win);
@@ -224,14 +234,25 @@ int main(int argc, char **argv) {
     // }
 
     hymn_add_func(vm, "graphics", canvas_rect_vm);
+    hymn_add_func(vm, "paint", canvas_paint_vm);
+    hymn_add_func(vm, "text", canvas_text_vm);
+    hymn_add_func(vm, "area_trigger", world_area_trigger_vm);
+    hymn_add_func(vm, "line_trigger", world_line_trigger_vm);
+    hymn_add_func(vm, "remove_trigger", world_remove_trigger_vm);
     hymn_add_pointer(vm, "canvas", canvas);
 
     Assets *assets = new_assets();
+    hymn_add_pointer(vm, "assets", assets);
 
     Game *game = safe_calloc(sizeof(Game), 1);
     game->win = win;
     game->vm = vm;
+    game->workers = new_worker_pool(SDL_GetCPUCount() - 1);
     game->game = new_game_state(canvas, &game->input, assets);
+    game->game->world->workers = game->workers;
+    game->game->world->cache = SDL_GetPrefPath("scroll-and-sigil", "cache");
+    game->game->replay_path = SDL_GetPrefPath("scroll-and-sigil", "replays");
+    hymn_add_pointer(vm, "world", game->game->world);
     game->paint = new_paint_state(canvas, &game->input, assets);
     game_switch_state(game, game->game);
 
@@ -247,8 +268,12 @@ int main(int argc, char **argv) {
     SDL_DestroyWindow(window);
     SDL_Quit();
 
+    char *cache = game->game->world->cache;
+    char *replays = game->game->replay_path;
     game_delete(game);
     assets_delete(assets);
+    SDL_free(cache);
+    SDL_free(replays);
 
     return 0;
 #endif
@@ -23,6 +23,7 @@
 #include "pie.h"
 #include "state.h"
 #include "wad.h"
+#include "worker.h"
 
 typedef struct Window Window;
 typedef struct Game Game;
@@ -37,6 +38,7 @@ struct Window {
 struct Game {
     Window *win;
     Hymn *vm;
+    WorkerPool *workers;
     Input input;
     GameState *game;
     PaintState *paint;
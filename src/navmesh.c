@@ -0,0 +1,833 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "navmesh.h"
+
+typedef struct NavSide NavSide;
+typedef struct NavBatch NavBatch;
+
+struct NavSide {
+    float ax;
+    float az;
+    float bx;
+    float bz;
+    int node;
+};
+
+struct NavBatch {
+    NavMesh *mesh;
+    NavRequest *requests;
+};
+
+static float nav_cross(float ox, float oz, float ax, float az, float bx, float bz) {
+    return (ax - ox) * (bz - oz) - (az - oz) * (bx - ox);
+}
+
+static int nav_side_compare(const void *a, const void *b) {
+    const NavSide *x = a;
+    const NavSide *y = b;
+    if (x->ax != y->ax) return x->ax < y->ax ? -1 : 1;
+    if (x->az != y->az) return x->az < y->az ? -1 : 1;
+    if (x->bx != y->bx) return x->bx < y->bx ? -1 : 1;
+    if (x->bz != y->bz) return x->bz < y->bz ? -1 : 1;
+    return x->node - y->node;
+}
+
+static bool nav_side_equal(NavSide *x, NavSide *y) {
+    return x->ax == y->ax and x->az == y->az and x->bx == y->bx and x->bz == y->bz;
+}
+
+static void nav_side_set(NavSide *this, Vec *a, Vec *b, int node) {
+    if (a->x < b->x or (a->x == b->x and a->y < b->y)) {
+        Vec *swap = a;
+        a = b;
+        b = swap;
+    }
+    this->ax = a->x;
+    this->az = a->y;
+    this->bx = b->x;
+    this->bz = b->y;
+    this->node = node;
+}
+
+static Line *nav_side_line(Sector *sec, NavSide *side) {
+    for (int i = 0; i < sec->line_count; i++) {
+        Line *ld = sec->lines[i];
+        Vec *a = ld->a;
+        Vec *b = ld->b;
+        if (a->x == side->ax and a->y == side->az and b->x == side->bx and b->y == side->bz)
+            return ld;
+        if (b->x == side->ax and b->y == side->az and a->x == side->bx and a->y == side->bz)
+            return ld;
+    }
+    return NULL;
+}
+
+static bool nav_walled(NavNode *from, NavNode *to, NavSide *side) {
+    Sector *a = from->sec;
+    Sector *b = to->sec;
+    if (a == b) {
+        return false;
+    }
+    Line *ld = nav_side_line(a, side);
+    if (ld == NULL) {
+        ld = nav_side_line(b, side);
+    }
+    return ld != NULL and ld->middle != NULL;
+}
+
+static bool nav_blocked(NavMesh *this, NavEdge *edge) {
+    Sector *a = this->nodes[edge->source].sec;
+    Sector *b = this->nodes[edge->target].sec;
+    if (a == b) {
+        return false;
+    }
+    float ends[4] = {edge->ax, edge->az, edge->bx, edge->bz};
+    for (int i = 0; i < 4; i += 2) {
+        float x = ends[i];
+        float z = ends[i + 1];
+        float floor = sector_floor_at(b, x, z);
+        if (floor - sector_floor_at(a, x, z) > NAV_STEP_HEIGHT) {
+            return true;
+        }
+        if (fminf(sector_ceiling_at(a, x, z), sector_ceiling_at(b, x, z)) - floor < NAV_AGENT_HEIGHT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void nav_link(NavMesh *this, int *links, int *link_count, int from, int to, int side, NavSide *sides) {
+    if (!nav_walled(&this->nodes[from], &this->nodes[to], &sides[side])) {
+        int *link = &links[(*link_count)++ * 3];
+        link[0] = from;
+        link[1] = to;
+        link[2] = side;
+        this->edge_offsets[from + 1]++;
+    }
+}
+
+NavMesh *new_navmesh(World *map) {
+    NavMesh *this = safe_calloc(1, sizeof(NavMesh));
+    this->map = map;
+
+    Sector **sectors = map->sectors;
+    int sector_count = map->sector_count;
+
+    int node_count = 0;
+    for (int i = 0; i < sector_count; i++) {
+        Sector *s = sectors[i];
+        s->nav_begin = node_count;
+        s->nav_count = 0;
+        for (int k = 0; k < s->triangle_count; k++) {
+            if (s->triangles[k]->normal > 0.0f) {
+                s->nav_count++;
+            }
+        }
+        node_count += s->nav_count;
+    }
+
+    this->node_count = node_count;
+    this->nodes = safe_malloc((node_count + 1) * sizeof(NavNode));
+    this->edge_offsets = safe_calloc(node_count + 2, sizeof(int));
+
+    NavSide *sides = safe_malloc((node_count * 3 + 1) * sizeof(NavSide));
+
+    int n = 0;
+    for (int i = 0; i < sector_count; i++) {
+        Sector *s = sectors[i];
+        for (int k = 0; k < s->triangle_count; k++) {
+            Triangle *td = s->triangles[k];
+            if (td->normal <= 0.0f) {
+                continue;
+            }
+            NavNode *node = &this->nodes[n];
+            node->x = (td->va.x + td->vb.x + td->vc.x) / 3.0f;
+            node->z = (td->va.y + td->vb.y + td->vc.y) / 3.0f;
+            node->sec = s;
+            node->triangle = td;
+            nav_side_set(&sides[n * 3], &td->va, &td->vb, n);
+            nav_side_set(&sides[n * 3 + 1], &td->vb, &td->vc, n);
+            nav_side_set(&sides[n * 3 + 2], &td->vc, &td->va, n);
+            n++;
+        }
+    }
+
+    int side_count = node_count * 3;
+    qsort(sides, side_count, sizeof(NavSide), nav_side_compare);
+
+    int link_cap = 16;
+    int link_count = 0;
+    int *links = safe_malloc(link_cap * 3 * sizeof(int));
+
+    int run = 0;
+    while (run < side_count) {
+        int end = run + 1;
+        while (end < side_count and nav_side_equal(&sides[run], &sides[end])) {
+            end++;
+        }
+        int pairs = (end - run) * (end - run - 1);
+        if (link_count + pairs > link_cap) {
+            while (link_count + pairs > link_cap) {
+                link_cap *= 2;
+            }
+            links = safe_realloc(links, link_cap * 3 * sizeof(int));
+        }
+        for (int i = run; i < end; i++) {
+            for (int k = i + 1; k < end; k++) {
+                int a = sides[i].node;
+                int b = sides[k].node;
+                if (a == b) {
+                    continue;
+                }
+                nav_link(this, links, &link_count, a, b, i, sides);
+                nav_link(this, links, &link_count, b, a, i, sides);
+            }
+        }
+        run = end;
+    }
+
+    for (int i = 0; i < node_count; i++) {
+        this->edge_offsets[i + 1] += this->edge_offsets[i];
+    }
+
+    this->edge_count = link_count;
+    this->edges = safe_malloc((link_count + 1) * sizeof(NavEdge));
+
+    int *fill = safe_malloc((node_count + 1) * sizeof(int));
+    memcpy(fill, this->edge_offsets, (node_count + 1) * sizeof(int));
+
+    for (int i = 0; i < link_count; i++) {
+        int *link = &links[i * 3];
+        NavNode *a = &this->nodes[link[0]];
+        NavNode *b = &this->nodes[link[1]];
+        NavSide *side = &sides[link[2]];
+        NavEdge *edge = &this->edges[fill[link[0]]++];
+        edge->source = link[0];
+        edge->target = link[1];
+        edge->cost = sqrtf((b->x - a->x) * (b->x - a->x) + (b->z - a->z) * (b->z - a->z));
+        edge->ax = side->ax;
+        edge->az = side->az;
+        edge->bx = side->bx;
+        edge->bz = side->bz;
+        edge->blocked = nav_blocked(this, edge);
+    }
+
+    this->reverse_offsets = safe_calloc(node_count + 2, sizeof(int));
+    this->reverse_edges = safe_malloc((link_count + 1) * sizeof(int));
+
+    for (int i = 0; i < link_count; i++) {
+        this->reverse_offsets[this->edges[i].target + 1]++;
+    }
+    for (int i = 0; i < node_count; i++) {
+        this->reverse_offsets[i + 1] += this->reverse_offsets[i];
+    }
+
+    memcpy(fill, this->reverse_offsets, (node_count + 1) * sizeof(int));
+
+    for (int i = 0; i < link_count; i++) {
+        this->reverse_edges[fill[this->edges[i].target]++] = i;
+    }
+
+    this->fields = safe_calloc(NAV_FLOW_FIELDS, sizeof(FlowField));
+
+    free(fill);
+    free(links);
+    free(sides);
+
+    return this;
+}
+
+static bool nav_in_triangle(Triangle *td, float x, float z) {
+    float d1 = nav_cross(td->va.x, td->va.y, td->vb.x, td->vb.y, x, z);
+    float d2 = nav_cross(td->vb.x, td->vb.y, td->vc.x, td->vc.y, x, z);
+    float d3 = nav_cross(td->vc.x, td->vc.y, td->va.x, td->va.y, x, z);
+    bool negative = d1 < -FLOAT_PRECISION or d2 < -FLOAT_PRECISION or d3 < -FLOAT_PRECISION;
+    bool positive = d1 > FLOAT_PRECISION or d2 > FLOAT_PRECISION or d3 > FLOAT_PRECISION;
+    return !(negative and positive);
+}
+
+int navmesh_locate(NavMesh *this, float x, float z) {
+    Sector *sec = world_find_sector(this->map, x, z);
+    while (sec != NULL and sec->nav_count == 0) {
+        sec = sec->outside;
+    }
+    if (sec == NULL) {
+        return -1;
+    }
+    int begin = sec->nav_begin;
+    int end = begin + sec->nav_count;
+    int nearest = begin;
+    float best = FLT_MAX;
+    for (int i = begin; i < end; i++) {
+        NavNode *node = &this->nodes[i];
+        if (nav_in_triangle(node->triangle, x, z)) {
+            return i;
+        }
+        float distance = (node->x - x) * (node->x - x) + (node->z - z) * (node->z - z);
+        if (distance < best) {
+            best = distance;
+            nearest = i;
+        }
+    }
+    return nearest;
+}
+
+static void nav_search_init(NavSearch *this, int node_count) {
+    this->g = safe_malloc((node_count + 1) * sizeof(float));
+    this->f = safe_malloc((node_count + 1) * sizeof(float));
+    this->parent = safe_malloc((node_count + 1) * sizeof(int));
+    this->via = safe_malloc((node_count + 1) * sizeof(int));
+    this->heap = safe_malloc((node_count + 1) * sizeof(int));
+    this->slot = safe_malloc((node_count + 1) * sizeof(int));
+    this->stamp = safe_calloc(node_count + 1, sizeof(unsigned int));
+    this->generation = 0;
+    this->route_cap = 16;
+    this->route = safe_malloc(this->route_cap * sizeof(int));
+    this->portals = safe_malloc((this->route_cap + 2) * 4 * sizeof(float));
+}
+
+static void nav_search_release(NavSearch *this) {
+    free(this->g);
+    free(this->f);
+    free(this->parent);
+    free(this->via);
+    free(this->heap);
+    free(this->slot);
+    free(this->stamp);
+    free(this->route);
+    free(this->portals);
+}
+
+static void nav_search_reserve(NavMesh *this, int count) {
+    if (count <= this->search_count) {
+        return;
+    }
+    this->searches = safe_realloc(this->searches, count * sizeof(NavSearch));
+    for (int i = this->search_count; i < count; i++) {
+        nav_search_init(&this->searches[i], this->node_count);
+    }
+    this->search_count = count;
+}
+
+static void nav_touch(NavSearch *this, int node) {
+    if (this->stamp[node] != this->generation) {
+        this->stamp[node] = this->generation;
+        this->g[node] = FLT_MAX;
+        this->parent[node] = -1;
+        this->via[node] = -1;
+        this->slot[node] = -1;
+    }
+}
+
+static void nav_heap_up(NavSearch *this, int i) {
+    int *heap = this->heap;
+    int node = heap[i];
+    float f = this->f[node];
+    while (i > 0) {
+        int up = (i - 1) >> 1;
+        if (this->f[heap[up]] <= f) {
+            break;
+        }
+        heap[i] = heap[up];
+        this->slot[heap[i]] = i;
+        i = up;
+    }
+    heap[i] = node;
+    this->slot[node] = i;
+}
+
+static void nav_heap_down(NavSearch *this, int i, int size) {
+    int *heap = this->heap;
+    int node = heap[i];
+    float f = this->f[node];
+    while (true) {
+        int child = i * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size and this->f[heap[child + 1]] < this->f[heap[child]]) {
+            child++;
+        }
+        if (this->f[heap[child]] >= f) {
+            break;
+        }
+        heap[i] = heap[child];
+        this->slot[heap[i]] = i;
+        i = child;
+    }
+    heap[i] = node;
+    this->slot[node] = i;
+}
+
+static void nav_path_push(NavPath *this, float x, float z) {
+    if (this->count > 0) {
+        float *last = &this->points[(this->count - 1) * 2];
+        if (last[0] == x and last[1] == z) {
+            return;
+        }
+    }
+    if (this->count == this->cap) {
+        this->cap = this->cap == 0 ? 8 : this->cap * 2;
+        this->points = safe_realloc(this->points, this->cap * 2 * sizeof(float));
+    }
+    this->points[this->count * 2] = x;
+    this->points[this->count * 2 + 1] = z;
+    this->count++;
+}
+
+static void nav_funnel(float *portals, int count, NavPath *path) {
+    float apex_x = portals[0];
+    float apex_z = portals[1];
+    float left_x = portals[0];
+    float left_z = portals[1];
+    float right_x = portals[2];
+    float right_z = portals[3];
+    int apex = 0;
+    int left = 0;
+    int right = 0;
+
+    nav_path_push(path, apex_x, apex_z);
+
+    for (int i = 1; i < count; i++) {
+        float *portal = &portals[i * 4];
+
+        if (nav_cross(apex_x, apex_z, right_x, right_z, portal[2], portal[3]) >= 0.0f) {
+            if ((apex_x == right_x and apex_z == right_z) or nav_cross(apex_x, apex_z, left_x, left_z, portal[2], portal[3]) < 0.0f) {
+                right_x = portal[2];
+                right_z = portal[3];
+                right = i;
+            } else {
+                apex_x = left_x;
+                apex_z = left_z;
+                apex = left;
+                nav_path_push(path, apex_x, apex_z);
+                right_x = apex_x;
+                right_z = apex_z;
+                right = apex;
+                i = apex;
+                continue;
+            }
+        }
+
+        if (nav_cross(apex_x, apex_z, left_x, left_z, portal[0], portal[1]) <= 0.0f) {
+            if ((apex_x == left_x and apex_z == left_z) or nav_cross(apex_x, apex_z, right_x, right_z, portal[0], portal[1]) > 0.0f) {
+                left_x = portal[0];
+                left_z = portal[1];
+                left = i;
+            } else {
+                apex_x = right_x;
+                apex_z = right_z;
+                apex = right;
+                nav_path_push(path, apex_x, apex_z);
+                left_x = apex_x;
+                left_z = apex_z;
+                left = apex;
+                i = apex;
+                continue;
+            }
+        }
+    }
+
+    float *end = &portals[(count - 1) * 4];
+    nav_path_push(path, end[0], end[1]);
+}
+
+static void nav_route(NavMesh *this, NavSearch *search, int goal, float from_x, float from_z, float to_x, float to_z, NavPath *path) {
+    int length = 0;
+    for (int node = goal; search->parent[node] != -1; node = search->parent[node]) {
+        length++;
+    }
+
+    if (length > search->route_cap) {
+        search->route_cap = length + 16;
+        search->route = safe_realloc(search->route, search->route_cap * sizeof(int));
+        search->portals = safe_realloc(search->portals, (search->route_cap + 2) * 4 * sizeof(float));
+    }
+
+    int k = length;
+    for (int node = goal; search->parent[node] != -1; node = search->parent[node]) {
+        search->route[--k] = node;
+    }
+
+    float *portals = search->portals;
+    portals[0] = from_x;
+    portals[1] = from_z;
+    portals[2] = from_x;
+    portals[3] = from_z;
+
+    for (int i = 0; i < length; i++) {
+        int node = search->route[i];
+        NavNode *a = &this->nodes[search->parent[node]];
+        NavNode *b = &this->nodes[node];
+        NavEdge *edge = &this->edges[search->via[node]];
+        float *portal = &portals[(i + 1) * 4];
+        if (nav_cross(a->x, a->z, b->x, b->z, edge->ax, edge->az) > 0.0f) {
+            portal[0] = edge->ax;
+            portal[1] = edge->az;
+            portal[2] = edge->bx;
+            portal[3] = edge->bz;
+        } else {
+            portal[0] = edge->bx;
+            portal[1] = edge->bz;
+            portal[2] = edge->ax;
+            portal[3] = edge->az;
+        }
+    }
+
+    float *last = &portals[(length + 1) * 4];
+    last[0] = to_x;
+    last[1] = to_z;
+    last[2] = to_x;
+    last[3] = to_z;
+
+    nav_funnel(portals, length + 2, path);
+}
+
+bool navmesh_find_path(NavMesh *this, int worker, float from_x, float from_z, float to_x, float to_z, NavPath *path) {
+    path->count = 0;
+
+    nav_search_reserve(this, worker + 1);
+    NavSearch *search = &this->searches[worker];
+
+    int start = navmesh_locate(this, from_x, from_z);
+    int goal = navmesh_locate(this, to_x, to_z);
+    if (start == -1 or goal == -1) {
+        return false;
+    }
+
+    search->generation++;
+    if (search->generation == 0) {
+        memset(search->stamp, 0, this->node_count * sizeof(unsigned int));
+        search->generation = 1;
+    }
+
+    NavNode *nodes = this->nodes;
+    NavNode *target = &nodes[goal];
+
+    nav_touch(search, start);
+    search->g[start] = 0.0f;
+    search->f[start] = sqrtf((target->x - from_x) * (target->x - from_x) + (target->z - from_z) * (target->z - from_z));
+    search->heap[0] = start;
+    search->slot[start] = 0;
+    int size = 1;
+
+    while (size > 0) {
+        int current = search->heap[0];
+        search->slot[current] = -2;
+        size--;
+        if (size > 0) {
+            search->heap[0] = search->heap[size];
+            nav_heap_down(search, 0, size);
+        }
+
+        if (current == goal) {
+            nav_route(this, search, goal, from_x, from_z, to_x, to_z, path);
+            return true;
+        }
+
+        float g = search->g[current];
+        int end = this->edge_offsets[current + 1];
+        for (int e = this->edge_offsets[current]; e < end; e++) {
+            NavEdge *edge = &this->edges[e];
+            if (edge->blocked) {
+                continue;
+            }
+            int next = edge->target;
+            nav_touch(search, next);
+            if (search->slot[next] == -2) {
+                continue;
+            }
+            float cost = g + edge->cost;
+            if (cost >= search->g[next]) {
+                continue;
+            }
+            NavNode *node = &nodes[next];
+            search->g[next] = cost;
+            search->f[next] = cost + sqrtf((node->x - to_x) * (node->x - to_x) + (node->z - to_z) * (node->z - to_z));
+            search->parent[next] = current;
+            search->via[next] = e;
+            if (search->slot[next] == -1) {
+                search->heap[size] = next;
+                nav_heap_up(search, size);
+                size++;
+            } else {
+                nav_heap_up(search, search->slot[next]);
+            }
+        }
+    }
+
+    return false;
+}
+
+static void nav_batch_task(void *context, int job, int worker) {
+    NavBatch *batch = context;
+    NavMesh *mesh = batch->mesh;
+    NavRequest *request = &batch->requests[job];
+    request->found = navmesh_find_path(mesh, worker, request->from_x, request->from_z, request->to_x, request->to_z, request->path);
+}
+
+void navmesh_find_paths(NavMesh *this, NavRequest *requests, int count) {
+    nav_search_reserve(this, worker_pool_size(this->map->workers));
+    NavBatch batch = {this, requests};
+    worker_pool_run(this->map->workers, nav_batch_task, &batch, count);
+}
+
+static int nav_step_locate(NavMesh *this, int hint, float x, float z) {
+    if (hint >= 0 and hint < this->node_count) {
+        if (nav_in_triangle(this->nodes[hint].triangle, x, z)) {
+            return hint;
+        }
+        int end = this->edge_offsets[hint + 1];
+        for (int e = this->edge_offsets[hint]; e < end; e++) {
+            int next = this->edges[e].target;
+            if (nav_in_triangle(this->nodes[next].triangle, x, z)) {
+                return next;
+            }
+        }
+    }
+    return navmesh_locate(this, x, z);
+}
+
+static void flow_field_init(FlowField *this, int node_count) {
+    this->distance = safe_malloc((node_count + 1) * sizeof(float));
+    this->next = safe_malloc((node_count + 1) * sizeof(int));
+    this->waypoint = safe_malloc((node_count + 1) * 2 * sizeof(float));
+    this->goal_node = -1;
+    nav_search_init(&this->search, node_count);
+}
+
+static void flow_field_release(FlowField *this) {
+    free(this->distance);
+    free(this->next);
+    free(this->waypoint);
+    nav_search_release(&this->search);
+}
+
+static NavEdge *nav_edge_between(NavMesh *this, int from, int to) {
+    NavEdge *best = NULL;
+    int end = this->edge_offsets[from + 1];
+    for (int e = this->edge_offsets[from]; e < end; e++) {
+        NavEdge *edge = &this->edges[e];
+        if (edge->target == to and !edge->blocked and (best == NULL or edge->cost < best->cost)) {
+            best = edge;
+        }
+    }
+    return best;
+}
+
+static void flow_field_reset(FlowField *this, int node_count) {
+    this->bias = 0.0f;
+    for (int i = 0; i < node_count; i++) {
+        this->distance[i] = FLT_MAX;
+        this->next[i] = -1;
+    }
+}
+
+void flow_field_refresh(FlowField *this, NavMesh *mesh, float x, float z) {
+    this->goal_x = x;
+    this->goal_z = z;
+
+    int goal = nav_step_locate(mesh, this->goal_node, x, z);
+    if (goal == this->goal_node) {
+        return;
+    }
+    int previous = this->goal_node;
+    this->goal_node = goal;
+
+    int node_count = mesh->node_count;
+    if (goal == -1) {
+        flow_field_reset(this, node_count);
+        return;
+    }
+
+    NavEdge *step = previous >= 0 ? nav_edge_between(mesh, previous, goal) : NULL;
+    if (step == NULL or this->bias > NAV_FLOW_REBASE) {
+        flow_field_reset(this, node_count);
+    } else {
+        this->bias += step->cost;
+        this->next[previous] = goal;
+        this->waypoint[previous * 2] = (step->ax + step->bx) * 0.5f;
+        this->waypoint[previous * 2 + 1] = (step->az + step->bz) * 0.5f;
+    }
+
+    float *distance = this->distance;
+    distance[goal] = -this->bias;
+    this->next[goal] = -1;
+
+    NavSearch *search = &this->search;
+    search->generation++;
+    if (search->generation == 0) {
+        memset(search->stamp, 0, node_count * sizeof(unsigned int));
+        search->generation = 1;
+    }
+
+    nav_touch(search, goal);
+    search->f[goal] = distance[goal];
+    search->heap[0] = goal;
+    search->slot[goal] = 0;
+    int size = 1;
+
+    while (size > 0) {
+        int current = search->heap[0];
+        search->slot[current] = -2;
+        size--;
+        if (size > 0) {
+            search->heap[0] = search->heap[size];
+            nav_heap_down(search, 0, size);
+        }
+
+        float g = distance[current];
+
+        int end = mesh->reverse_offsets[current + 1];
+        for (int r = mesh->reverse_offsets[current]; r < end; r++) {
+            NavEdge *edge = &mesh->edges[mesh->reverse_edges[r]];
+            if (edge->blocked) {
+                continue;
+            }
+            int source = edge->source;
+            nav_touch(search, source);
+            if (search->slot[source] == -2) {
+                continue;
+            }
+            float cost = g + edge->cost;
+            if (cost >= distance[source]) {
+                continue;
+            }
+            distance[source] = cost;
+            search->f[source] = cost;
+            this->next[source] = current;
+            this->waypoint[source * 2] = (edge->ax + edge->bx) * 0.5f;
+            this->waypoint[source * 2 + 1] = (edge->az + edge->bz) * 0.5f;
+            if (search->slot[source] == -1) {
+                search->heap[size] = source;
+                nav_heap_up(search, size);
+                size++;
+            } else {
+                nav_heap_up(search, search->slot[source]);
+            }
+        }
+    }
+}
+
+bool flow_field_sample(FlowField *this, NavMesh *mesh, float x, float z, int *hint, float *dx, float *dz) {
+    int node = nav_step_locate(mesh, *hint, x, z);
+    *hint = node;
+    if (node == -1 or this->goal_node == -1) {
+        return false;
+    }
+    float tx;
+    float tz;
+    if (node == this->goal_node) {
+        tx = this->goal_x;
+        tz = this->goal_z;
+    } else if (this->next[node] != -1) {
+        tx = this->waypoint[node * 2];
+        tz = this->waypoint[node * 2 + 1];
+    } else {
+        return false;
+    }
+    float vx = tx - x;
+    float vz = tz - z;
+    float length = sqrtf(vx * vx + vz * vz);
+    if (FLOAT_ZERO(length)) {
+        *dx = 0.0f;
+        *dz = 0.0f;
+    } else {
+        *dx = vx / length;
+        *dz = vz / length;
+    }
+    return true;
+}
+
+FlowField *navmesh_flow_field(NavMesh *this, Thing *goal) {
+    FlowField *field = NULL;
+    for (int i = 0; i < NAV_FLOW_FIELDS; i++) {
+        if (this->fields[i].goal == goal) {
+            field = &this->fields[i];
+            break;
+        }
+    }
+    if (field == NULL) {
+        field = &this->fields[0];
+        for (int i = 1; i < NAV_FLOW_FIELDS; i++) {
+            if (this->fields[i].used < field->used) {
+                field = &this->fields[i];
+            }
+        }
+        if (field->distance == NULL) {
+            flow_field_init(field, this->node_count);
+        }
+        field->goal = goal;
+        field->goal_node = -2;
+    }
+    field->used = this->map->tick + 1;
+    ThingStore *store = &this->map->store;
+    flow_field_refresh(field, this, store->x[goal->index], store->z[goal->index]);
+    return field;
+}
+
+void navmesh_forget(NavMesh *this, Thing *goal) {
+    for (int i = 0; i < NAV_FLOW_FIELDS; i++) {
+        FlowField *field = &this->fields[i];
+        if (field->goal == goal) {
+            field->goal = NULL;
+            field->goal_node = -2;
+            field->used = 0;
+        }
+    }
+}
+
+static bool nav_update_edge(NavMesh *this, NavEdge *edge) {
+    bool blocked = nav_blocked(this, edge);
+    if (blocked == edge->blocked) {
+        return false;
+    }
+    edge->blocked = blocked;
+    return true;
+}
+
+void navmesh_update_sector(NavMesh *this, Sector *sec) {
+    bool changed = false;
+    int end = sec->nav_begin + sec->nav_count;
+    for (int n = sec->nav_begin; n < end; n++) {
+        for (int e = this->edge_offsets[n]; e < this->edge_offsets[n + 1]; e++) {
+            changed |= nav_update_edge(this, &this->edges[e]);
+        }
+        for (int r = this->reverse_offsets[n]; r < this->reverse_offsets[n + 1]; r++) {
+            changed |= nav_update_edge(this, &this->edges[this->reverse_edges[r]]);
+        }
+    }
+    if (changed) {
+        for (int i = 0; i < NAV_FLOW_FIELDS; i++) {
+            this->fields[i].goal_node = -2;
+        }
+    }
+}
+
+void navmesh_delete(NavMesh *this) {
+    for (int i = 0; i < this->search_count; i++) {
+        nav_search_release(&this->searches[i]);
+    }
+    free(this->searches);
+    for (int i = 0; i < NAV_FLOW_FIELDS; i++) {
+        if (this->fields[i].distance != NULL) {
+            flow_field_release(&this->fields[i]);
+        }
+    }
+    free(this->fields);
+    free(this->reverse_offsets);
+    free(this->reverse_edges);
+    free(this->nodes);
+    free(this->edge_offsets);
+    free(this->edges);
+    free(this);
+}
+
+void nav_path_release(NavPath *this) {
+    free(this->points);
+    this->points = NULL;
+    this->count = 0;
+    this->cap = 0;
+}
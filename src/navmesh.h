@@ -0,0 +1,118 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef NAVMESH_H
+#define NAVMESH_H
+
+#include <float.h>
+#include <math.h>
+
+#include "mem.h"
+#include "pie.h"
+#include "sector.h"
+#include "triangle.h"
+#include "worker.h"
+#include "world.h"
+
+#define NAV_STEP_HEIGHT 1.0f
+#define NAV_AGENT_HEIGHT 2.0f
+#define NAV_FLOW_FIELDS 4
+#define NAV_FLOW_REBASE 4096.0f
+
+typedef struct NavNode NavNode;
+typedef struct NavEdge NavEdge;
+typedef struct NavSearch NavSearch;
+typedef struct NavPath NavPath;
+typedef struct NavRequest NavRequest;
+typedef struct FlowField FlowField;
+
+struct NavNode {
+    float x;
+    float z;
+    Sector *sec;
+    Triangle *triangle;
+};
+
+struct NavEdge {
+    int source;
+    int target;
+    float cost;
+    float ax;
+    float az;
+    float bx;
+    float bz;
+    bool blocked;
+};
+
+struct NavSearch {
+    float *g;
+    float *f;
+    int *parent;
+    int *via;
+    int *heap;
+    int *slot;
+    unsigned int *stamp;
+    unsigned int generation;
+    int *route;
+    float *portals;
+    int route_cap;
+};
+
+struct NavMesh {
+    World *map;
+    NavNode *nodes;
+    int node_count;
+    int *edge_offsets;
+    NavEdge *edges;
+    int edge_count;
+    int *reverse_offsets;
+    int *reverse_edges;
+    NavSearch *searches;
+    int search_count;
+    FlowField *fields;
+};
+
+struct NavPath {
+    float *points;
+    int count;
+    int cap;
+};
+
+struct NavRequest {
+    float from_x;
+    float from_z;
+    float to_x;
+    float to_z;
+    NavPath *path;
+    bool found;
+};
+
+struct FlowField {
+    Thing *goal;
+    int goal_node;
+    float goal_x;
+    float goal_z;
+    float *distance;
+    float bias;
+    int *next;
+    float *waypoint;
+    unsigned int used;
+    NavSearch search;
+};
+
+NavMesh *new_navmesh(World *map);
+int navmesh_locate(NavMesh *this, float x, float z);
+bool navmesh_find_path(NavMesh *this, int worker, float from_x, float from_z, float to_x, float to_z, NavPath *path);
+void navmesh_find_paths(NavMesh *this, NavRequest *requests, int count);
+FlowField *navmesh_flow_field(NavMesh *this, Thing *goal);
+void navmesh_forget(NavMesh *this, Thing *goal);
+void navmesh_update_sector(NavMesh *this, Sector *sec);
+void navmesh_delete(NavMesh *this);
+
+void flow_field_refresh(FlowField *this, NavMesh *mesh, float x, float z);
+bool flow_field_sample(FlowField *this, NavMesh *mesh, float x, float z, int *hint, float *dx, float *dz);
+
+void nav_path_release(NavPath *this);
+
+#endif
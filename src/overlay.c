@@ -0,0 +1,167 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "overlay.h"
+
+static const u32 depth_colors[] = {0xffffff, 0x41a6f6, 0x38b764, 0xffcd75, 0xef7d57, 0xb13e53};
+
+static const char *mode_names[] = {"none", "lines", "things", "tests"};
+
+typedef struct View View;
+
+struct View {
+    float scale;
+    float bottom;
+};
+
+static i32 view_x(View *view, float x) {
+    return (i32)(x * view->scale);
+}
+
+static i32 view_y(View *view, float z) {
+    return (i32)(view->bottom - z * view->scale);
+}
+
+static int cell_value(Cell *c, enum OverlayMode mode) {
+    switch (mode) {
+    case OVERLAY_CELL_LINES: return c->line_count;
+    case OVERLAY_CELL_THINGS: return c->thing_count;
+    case OVERLAY_CELL_TESTS: return c->tests;
+    default: return 0;
+    }
+}
+
+static u32 heat(int value, int maximum) {
+    if (value == 0 or maximum == 0) {
+        return rgb(16, 16, 24);
+    }
+    int t = (value * 255) / maximum;
+    return rgb((u8)t, (u8)(t >> 2), (u8)(64 - (t >> 2)));
+}
+
+static int sector_depth(Sector *s) {
+    int depth = 0;
+    while (s->outside != NULL) {
+        s = s->outside;
+        depth++;
+    }
+    return depth;
+}
+
+static void draw_cells(Canvas *canvas, World *world, View *view, enum OverlayMode mode) {
+    const int size = 1 << WORLD_CELL_SHIFT;
+    int columns = world->columns;
+    int rows = world->rows;
+
+    int maximum = 0;
+    for (int i = 0; i < world->cell_count; i++) {
+        int value = cell_value(&world->cells[i], mode);
+        if (value > maximum) {
+            maximum = value;
+        }
+    }
+
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            Cell *cell = &world->cells[c + r * columns];
+            i32 x0 = view_x(view, (float)(c * size));
+            i32 y0 = view_y(view, (float)((r + 1) * size));
+            i32 x1 = view_x(view, (float)((c + 1) * size));
+            i32 y1 = view_y(view, (float)(r * size));
+            canvas_rect(canvas, heat(cell_value(cell, mode), maximum), x0, y0, x1, y1);
+        }
+    }
+
+    u32 grid = rgb(48, 48, 64);
+    i32 top = view_y(view, (float)(rows * size));
+    i32 bottom = view_y(view, 0.0f);
+    i32 left = view_x(view, 0.0f);
+    i32 right = view_x(view, (float)(columns * size));
+
+    for (int c = 0; c <= columns; c++) {
+        i32 x = view_x(view, (float)(c * size));
+        canvas_line(canvas, grid, x, top, x, bottom);
+    }
+
+    for (int r = 0; r <= rows; r++) {
+        i32 y = view_y(view, (float)(r * size));
+        canvas_line(canvas, grid, left, y, right, y);
+    }
+}
+
+static void draw_sectors(Canvas *canvas, World *world, View *view) {
+    int count = sizeof(depth_colors) / sizeof(depth_colors[0]);
+    for (int i = 0; i < world->sector_count; i++) {
+        Sector *s = world->sectors[i];
+        int depth = sector_depth(s);
+        u32 color = depth_colors[depth < count ? depth : count - 1];
+        for (int k = 0; k < s->line_count; k++) {
+            Line *ld = s->lines[k];
+            canvas_line(canvas, color, view_x(view, ld->a->x), view_y(view, ld->a->y), view_x(view, ld->b->x), view_y(view, ld->b->y));
+        }
+    }
+}
+
+static void draw_things(Canvas *canvas, World *world, View *view) {
+    u32 color = rgb(255, 255, 0);
+    ThingStore *store = &world->store;
+    for (int i = 0; i < world->thing_count; i++) {
+        float box = store->box[i];
+        i32 x0 = view_x(view, store->x[i] - box);
+        i32 y0 = view_y(view, store->z[i] + box);
+        i32 x1 = view_x(view, store->x[i] + box);
+        i32 y1 = view_y(view, store->z[i] - box);
+        canvas_line(canvas, color, x0, y0, x1, y0);
+        canvas_line(canvas, color, x1, y0, x1, y1);
+        canvas_line(canvas, color, x1, y1, x0, y1);
+        canvas_line(canvas, color, x0, y1, x0, y0);
+    }
+}
+
+static void draw_stats(Canvas *canvas, World *world, Font *font, enum OverlayMode mode) {
+    int lines = 0;
+    int things = 0;
+    for (int i = 0; i < world->cell_count; i++) {
+        Cell *c = &world->cells[i];
+        if (c->line_count > lines) {
+            lines = c->line_count;
+        }
+        if (c->thing_count > things) {
+            things = c->thing_count;
+        }
+    }
+
+    char text[128];
+    snprintf(text, sizeof(text), "cell shift %d (%dx%d) mode %s\nmax lines %d max things %d\nthing tests %d line tests %d", WORLD_CELL_SHIFT, world->columns, world->rows, mode_names[mode], lines, things, worker_counter_get(world->thing_tests), worker_counter_get(world->line_tests));
+
+    i32 x = 4;
+    i32 y = canvas->height - 3 * font->glyph_height - 4;
+    canvas_rect(canvas, rgb(0, 0, 0), x - 2, y - 2, x + font_text_width(font, text) + 2, canvas->height - 2);
+    canvas_text(canvas, font, rgb(255, 255, 255), x, y, text);
+}
+
+void overlay_draw(Canvas *canvas, World *world, Font *font, enum OverlayMode mode) {
+    if (mode == OVERLAY_NONE or world->cell_count == 0) {
+        return;
+    }
+
+    const int size = 1 << WORLD_CELL_SHIFT;
+    float width = (float)(world->columns * size);
+    float height = (float)(world->rows * size);
+
+    float scale_x = (float)(canvas->width - 1) / width;
+    float scale_y = (float)(canvas->height - 1) / height;
+
+    View view;
+    view.scale = scale_x < scale_y ? scale_x : scale_y;
+    view.bottom = height * view.scale;
+
+    draw_cells(canvas, world, &view, mode);
+    draw_sectors(canvas, world, &view);
+    draw_things(canvas, world, &view);
+
+    if (font != NULL) {
+        draw_stats(canvas, world, font, mode);
+    }
+}
@@ -0,0 +1,23 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "canvas.h"
+#include "font.h"
+#include "pie.h"
+#include "world.h"
+
+enum OverlayMode {
+    OVERLAY_NONE,
+    OVERLAY_CELL_LINES,
+    OVERLAY_CELL_THINGS,
+    OVERLAY_CELL_TESTS,
+    OVERLAY_MODE_COUNT,
+};
+
+void overlay_draw(Canvas *canvas, World *world, Font *font, enum OverlayMode mode);
+
+#endif
@@ -4,11 +4,112 @@
 
 #include "paint.h"
 
+static const u32 sweetie_16[] = {
+    0x1a1c2c, 0x5d275d, 0xb13e53, 0xef7d57, 0xffcd75, 0xa7f070, 0x38b764, 0x257179,
+    0x29366f, 0x3b5dc9, 0x41a6f6, 0x73eff7, 0xf4f4f4, 0x94b0c2, 0x566c86, 0x333c57,
+};
+
 Paint *new_paint() {
     return safe_calloc(sizeof(Paint), 1);
 }
 
+Paint *paint_from_wad(Wad *wad) {
+    Paint *this = new_paint();
+    this->width = wad_get_int(wad_get_from_object(wad, "columns"));
+    this->height = wad_get_int(wad_get_from_object(wad, "rows"));
+
+    i32 size = this->width * this->height;
+    this->pixels = safe_calloc(size, sizeof(u8));
+
+    WadArray *pixels = wad_get_array_from_object(wad, "pixels");
+    if (pixels != NULL) {
+        i32 count = (i32)array_size(pixels);
+        if (count > size) {
+            count = size;
+        }
+        for (i32 i = 0; i < count; i++) {
+            this->pixels[i] = (u8)wad_get_int(pixels->items[i]);
+        }
+    }
+
+    paint_bake_spans(this);
+    return this;
+}
+
+Paint *paint_checker(i32 size, u8 a, u8 b) {
+    Paint *this = new_paint();
+    this->width = size;
+    this->height = size;
+    this->pixels = safe_malloc(size * size * sizeof(u8));
+    i32 half = size / 2;
+    for (i32 y = 0; y < size; y++) {
+        for (i32 x = 0; x < size; x++) {
+            this->pixels[x + y * size] = ((x / half + y / half) & 1) ? a : b;
+        }
+    }
+    paint_bake_spans(this);
+    return this;
+}
+
+void paint_bake_spans(Paint *this) {
+    i32 width = this->width;
+    i32 height = this->height;
+    u8 *pixels = this->pixels;
+
+    i32 count = 0;
+    i32 cap = 0;
+    PaintSpan *spans = NULL;
+
+    for (i32 y = 0; y < height; y++) {
+        u8 *row = &pixels[y * width];
+        i32 x = 0;
+        while (x < width) {
+            if (row[x] == PAINT_TRANSPARENT) {
+                x++;
+                continue;
+            }
+            i32 start = x;
+            while (x < width and row[x] != PAINT_TRANSPARENT) {
+                x++;
+            }
+            if (count == cap) {
+                cap += 64;
+                spans = safe_realloc(spans, cap * sizeof(PaintSpan));
+            }
+            spans[count] = (PaintSpan){start, y, x - start};
+            count++;
+        }
+    }
+
+    free(this->spans);
+    this->spans = spans;
+    this->span_count = count;
+}
+
+void paint_bake_colors(Paint *this, u32 *palette) {
+    i32 size = this->width * this->height;
+    if (this->colors == NULL) {
+        this->colors = safe_malloc(size * sizeof(u32));
+    }
+    u8 *pixels = this->pixels;
+    u32 *colors = this->colors;
+    for (i32 i = 0; i < size; i++) {
+        colors[i] = palette[pixels[i]];
+    }
+}
+
+void paint_bake_default_colors(Paint *this) {
+    u32 palette[PAINT_PALETTE_SIZE];
+    int count = sizeof(sweetie_16) / sizeof(sweetie_16[0]);
+    for (int i = 0; i < PAINT_PALETTE_SIZE; i++) {
+        palette[i] = sweetie_16[i % count];
+    }
+    paint_bake_colors(this, palette);
+}
+
 void paint_delete(Paint *this) {
     free(this->pixels);
+    free(this->colors);
+    free(this->spans);
     free(this);
 }
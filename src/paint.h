@@ -7,16 +7,36 @@
 
 #include "mem.h"
 #include "pie.h"
+#include "wad.h"
 
+#define PAINT_TRANSPARENT 0
+#define PAINT_PALETTE_SIZE 256
+
+typedef struct PaintSpan PaintSpan;
 typedef struct Paint Paint;
 
+struct PaintSpan {
+    i32 x;
+    i32 y;
+    i32 length;
+};
+
 struct Paint {
     i32 width;
     i32 height;
     u8 *pixels;
+    u32 *colors;
+    PaintSpan *spans;
+    i32 span_count;
 };
 
 Paint *new_paint();
+Paint *paint_from_wad(Wad *wad);
+Paint *paint_checker(i32 size, u8 a, u8 b);
+
+void paint_bake_spans(Paint *this);
+void paint_bake_colors(Paint *this, u32 *palette);
+void paint_bake_default_colors(Paint *this);
 
 void paint_delete(Paint *this);
 
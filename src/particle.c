@@ -0,0 +1,180 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "world.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static u32 particle_random(ParticlePool *this) {
+    u32 x = this->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    this->seed = x;
+    return x;
+}
+
+static float particle_random_unit(ParticlePool *this) {
+    return (float)(particle_random(this) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+void particle_pool_init(ParticlePool *this) {
+    usize size = PARTICLE_CAPACITY * sizeof(float);
+    this->x = safe_malloc(size);
+    this->y = safe_malloc(size);
+    this->z = safe_malloc(size);
+    this->dx = safe_malloc(size);
+    this->dy = safe_malloc(size);
+    this->dz = safe_malloc(size);
+    this->floor = safe_malloc(size);
+    this->ceiling = safe_malloc(size);
+    this->life = safe_malloc(size);
+    this->texture = safe_malloc(PARTICLE_CAPACITY * sizeof(int));
+    this->dead = safe_calloc(PARTICLE_CAPACITY, sizeof(u8));
+    this->count = 0;
+    this->seed = 0x9e3779b9;
+}
+
+int particle_spawn(ParticlePool *this, Sector *sec, float x, float y, float z, float dx, float dy, float dz, float life, int texture) {
+    if (this->count == PARTICLE_CAPACITY) {
+        return -1;
+    }
+    int i = this->count++;
+    this->x[i] = x;
+    this->y[i] = y;
+    this->z[i] = z;
+    this->dx[i] = dx;
+    this->dy[i] = dy;
+    this->dz[i] = dz;
+    this->floor[i] = sector_floor_at(sec, x, z);
+    this->ceiling[i] = sector_ceiling_at(sec, x, z);
+    this->life[i] = life;
+    this->texture[i] = texture;
+    this->dead[i] = 0;
+    return i;
+}
+
+int particle_explosion(ParticlePool *this, Sector *sec, float x, float y, float z, float speed, float life, int count, int texture) {
+    int available = PARTICLE_CAPACITY - this->count;
+    if (count > available) {
+        count = available;
+    }
+    float floor = sector_floor_at(sec, x, z);
+    float ceiling = sector_ceiling_at(sec, x, z);
+    int begin = this->count;
+    int end = begin + count;
+    for (int i = begin; i < end; i++) {
+        float dx = particle_random_unit(this);
+        float dy = particle_random_unit(this);
+        float dz = particle_random_unit(this);
+        float scale = speed / (sqrtf(dx * dx + dy * dy + dz * dz) + FLT_EPSILON);
+        this->x[i] = x;
+        this->y[i] = y;
+        this->z[i] = z;
+        this->dx[i] = dx * scale;
+        this->dy[i] = dy * scale;
+        this->dz[i] = dz * scale;
+        this->floor[i] = floor;
+        this->ceiling[i] = ceiling;
+        this->life[i] = life * (0.5f + 0.5f * fabsf(particle_random_unit(this)));
+        this->texture[i] = texture;
+        this->dead[i] = 0;
+    }
+    this->count = end;
+    return count;
+}
+
+void particles_integrate(ParticlePool *this, int begin, int end) {
+    float *restrict x = this->x;
+    float *restrict y = this->y;
+    float *restrict z = this->z;
+    float *restrict dx = this->dx;
+    float *restrict dy = this->dy;
+    float *restrict dz = this->dz;
+    float *restrict floor = this->floor;
+    float *restrict ceiling = this->ceiling;
+    float *restrict life = this->life;
+    u8 *restrict dead = this->dead;
+
+    int i = begin;
+
+#ifdef __SSE2__
+    const __m128 drag = _mm_set1_ps(wind_resistance);
+    const __m128 fall = _mm_set1_ps(gravity);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(dx + i), drag);
+        __m128 vy = _mm_sub_ps(_mm_loadu_ps(dy + i), fall);
+        __m128 vz = _mm_mul_ps(_mm_loadu_ps(dz + i), drag);
+
+        __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), vx);
+        __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), vy);
+        __m128 pz = _mm_add_ps(_mm_loadu_ps(z + i), vz);
+
+        __m128 top = _mm_loadu_ps(ceiling + i);
+        __m128 hit_ceiling = _mm_cmpgt_ps(py, top);
+        py = _mm_or_ps(_mm_and_ps(hit_ceiling, top), _mm_andnot_ps(hit_ceiling, py));
+        vy = _mm_andnot_ps(hit_ceiling, vy);
+
+        __m128 remaining = _mm_sub_ps(_mm_loadu_ps(life + i), one);
+        __m128 hit_floor = _mm_cmplt_ps(py, _mm_loadu_ps(floor + i));
+        __m128 expired = _mm_or_ps(hit_floor, _mm_cmple_ps(remaining, zero));
+
+        _mm_storeu_ps(dx + i, vx);
+        _mm_storeu_ps(dy + i, vy);
+        _mm_storeu_ps(dz + i, vz);
+        _mm_storeu_ps(x + i, px);
+        _mm_storeu_ps(y + i, py);
+        _mm_storeu_ps(z + i, pz);
+        _mm_storeu_ps(life + i, remaining);
+
+        int mask = _mm_movemask_ps(expired);
+        dead[i] = (u8)(mask & 1);
+        dead[i + 1] = (u8)((mask >> 1) & 1);
+        dead[i + 2] = (u8)((mask >> 2) & 1);
+        dead[i + 3] = (u8)((mask >> 3) & 1);
+    }
+#endif
+
+    for (; i < end; i++) {
+        dx[i] *= wind_resistance;
+        dy[i] -= gravity;
+        dz[i] *= wind_resistance;
+        x[i] += dx[i];
+        y[i] += dy[i];
+        z[i] += dz[i];
+        if (y[i] > ceiling[i]) {
+            y[i] = ceiling[i];
+            dy[i] = 0.0f;
+        }
+        life[i] -= 1.0f;
+        dead[i] = (u8)(y[i] < floor[i] or life[i] <= 0.0f);
+    }
+}
+
+void particles_compact(ParticlePool *this) {
+    int count = this->count;
+    for (int i = count - 1; i >= 0; i--) {
+        if (this->dead[i] == 0) {
+            continue;
+        }
+        int last = --count;
+        this->x[i] = this->x[last];
+        this->y[i] = this->y[last];
+        this->z[i] = this->z[last];
+        this->dx[i] = this->dx[last];
+        this->dy[i] = this->dy[last];
+        this->dz[i] = this->dz[last];
+        this->floor[i] = this->floor[last];
+        this->ceiling[i] = this->ceiling[last];
+        this->life[i] = this->life[last];
+        this->texture[i] = this->texture[last];
+        this->dead[i] = 0;
+    }
+    this->count = count;
+}
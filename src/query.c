@@ -0,0 +1,72 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "world.h"
+
+static void query_cells(World *this, float left, float bottom, float right, float top, int *c_min, int *r_min, int *c_max, int *r_max) {
+    float pad = this->thing_box_max;
+
+    int c0 = (int)floorf(left - pad) >> WORLD_CELL_SHIFT;
+    int r0 = (int)floorf(bottom - pad) >> WORLD_CELL_SHIFT;
+    int c1 = (int)floorf(right + pad) >> WORLD_CELL_SHIFT;
+    int r1 = (int)floorf(top + pad) >> WORLD_CELL_SHIFT;
+
+    *c_min = c0 < 0 ? 0 : c0;
+    *r_min = r0 < 0 ? 0 : r0;
+    *c_max = c1 >= this->columns ? this->columns - 1 : c1;
+    *r_max = r1 >= this->rows ? this->rows - 1 : r1;
+}
+
+int world_query_radius(World *this, float x, float z, float radius, Thing **results, int capacity) {
+    int c_min, r_min, c_max, r_max;
+    query_cells(this, x - radius, z - radius, x + radius, z + radius, &c_min, &r_min, &c_max, &r_max);
+
+    ThingStore *store = &this->store;
+    float squared = radius * radius;
+    int count = 0;
+
+    for (int r = r_min; r <= r_max; r++) {
+        for (int c = c_min; c <= c_max; c++) {
+            Cell *cell = &this->cells[c + r * this->columns];
+            for (int k = cell->thing_head; k != -1; k = store->next[k]) {
+                float box = store->box[k];
+                float nearest_x = fminf(fmaxf(x, store->x[k] - box), store->x[k] + box) - x;
+                float nearest_z = fminf(fmaxf(z, store->z[k] - box), store->z[k] + box) - z;
+                if (nearest_x * nearest_x + nearest_z * nearest_z > squared)
+                    continue;
+                if (count < capacity) {
+                    results[count] = this->things[k];
+                }
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+int world_query_box(World *this, float left, float bottom, float right, float top, Thing **results, int capacity) {
+    int c_min, r_min, c_max, r_max;
+    query_cells(this, left, bottom, right, top, &c_min, &r_min, &c_max, &r_max);
+
+    ThingStore *store = &this->store;
+    int count = 0;
+
+    for (int r = r_min; r <= r_max; r++) {
+        for (int c = c_min; c <= c_max; c++) {
+            Cell *cell = &this->cells[c + r * this->columns];
+            for (int k = cell->thing_head; k != -1; k = store->next[k]) {
+                float box = store->box[k];
+                if (store->x[k] + box < left or store->x[k] - box > right or store->z[k] + box < bottom or store->z[k] - box > top)
+                    continue;
+                if (count < capacity) {
+                    results[count] = this->things[k];
+                }
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,236 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "world.h"
+
+#define RAY_BATCH 64
+#define RAY_HISTORY 4
+
+typedef struct RayBatch RayBatch;
+
+struct RayBatch {
+    World *map;
+    Ray *rays;
+    int count;
+    RayFilter filter;
+    void *context;
+    RayHit *hits;
+};
+
+static bool ray_default_filter(void *context, Line *line, Thing *thing) {
+    (void)context;
+    (void)thing;
+    return line == NULL or line->middle != NULL or line->plus == NULL;
+}
+
+static float ray_line(float x, float z, float dx, float dz, Line *ld) {
+    float ax = ld->a->x;
+    float az = ld->a->y;
+    float vx = ld->b->x - ax;
+    float vz = ld->b->y - az;
+
+    float denominator = dx * vz - dz * vx;
+    if (FLOAT_ZERO(denominator))
+        return FLT_MAX;
+
+    float wx = ax - x;
+    float wz = az - z;
+
+    float t = (wx * vz - wz * vx) / denominator;
+    float u = (wx * dz - wz * dx) / denominator;
+
+    if (t < 0.0f or u < 0.0f or u > 1.0f)
+        return FLT_MAX;
+
+    return t;
+}
+
+static float ray_box(float x, float z, float inverse_x, float inverse_z, float cx, float cz, float box) {
+    float t1 = (cx - box - x) * inverse_x;
+    float t2 = (cx + box - x) * inverse_x;
+    float t3 = (cz - box - z) * inverse_z;
+    float t4 = (cz + box - z) * inverse_z;
+
+    float near = fmaxf(fminf(t1, t2), fminf(t3, t4));
+    float far = fminf(fmaxf(t1, t2), fmaxf(t3, t4));
+
+    if (far < 0.0f or near > far)
+        return FLT_MAX;
+
+    return near < 0.0f ? 0.0f : near;
+}
+
+static bool ray_seen(int c, int r, int reach, int *history_c, int *history_r, int history) {
+    for (int h = 0; h < history; h++) {
+        if (abs(c - history_c[h]) <= reach and abs(r - history_r[h]) <= reach) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool world_raycast(World *this, Ray *ray, RayFilter filter, void *context, RayHit *hit) {
+    if (filter == NULL) {
+        filter = ray_default_filter;
+    }
+
+    float length = sqrtf(ray->dx * ray->dx + ray->dz * ray->dz);
+
+    hit->distance = ray->distance;
+    hit->line = NULL;
+    hit->thing = NULL;
+
+    if (FLOAT_ZERO(length) or this->cell_count == 0) {
+        hit->x = ray->x;
+        hit->z = ray->z;
+        return false;
+    }
+
+    float x = ray->x;
+    float z = ray->z;
+    float dx = ray->dx / length;
+    float dz = ray->dz / length;
+    float inverse_x = FLOAT_ZERO(dx) ? FLT_MAX : 1.0f / dx;
+    float inverse_z = FLOAT_ZERO(dz) ? FLT_MAX : 1.0f / dz;
+
+    const float size = (float)(1 << WORLD_CELL_SHIFT);
+
+    float width = this->columns * size;
+    float height = this->rows * size;
+
+    float t1 = (-size - x) * inverse_x;
+    float t2 = (width + size - x) * inverse_x;
+    float t3 = (-size - z) * inverse_z;
+    float t4 = (height + size - z) * inverse_z;
+
+    float enter = fmaxf(fminf(t1, t2), fminf(t3, t4));
+    float leave = fminf(fmaxf(t1, t2), fmaxf(t3, t4));
+
+    if (leave < 0.0f or enter > leave or enter > ray->distance) {
+        hit->x = x + dx * ray->distance;
+        hit->z = z + dz * ray->distance;
+        return false;
+    }
+
+    if (enter < 0.0f) {
+        enter = 0.0f;
+    }
+
+    float start_x = x + dx * enter;
+    float start_z = z + dz * enter;
+
+    int c = (int)floorf(start_x / size);
+    int r = (int)floorf(start_z / size);
+    if (c > this->columns) c = this->columns;
+    if (r > this->rows) r = this->rows;
+    if (c < -1) c = -1;
+    if (r < -1) r = -1;
+
+    int step_c = dx > 0.0f ? 1 : -1;
+    int step_r = dz > 0.0f ? 1 : -1;
+
+    float next_c = FLOAT_ZERO(dx) ? FLT_MAX : ((c + (dx > 0.0f)) * size - x) * inverse_x;
+    float next_r = FLOAT_ZERO(dz) ? FLT_MAX : ((r + (dz > 0.0f)) * size - z) * inverse_z;
+    float delta_c = FLOAT_ZERO(dx) ? FLT_MAX : size * fabsf(inverse_x);
+    float delta_r = FLOAT_ZERO(dz) ? FLT_MAX : size * fabsf(inverse_z);
+
+    int reach = (int)ceilf(this->thing_box_max / size);
+    if (reach < 1) {
+        reach = 1;
+    }
+
+    int history_c[RAY_HISTORY];
+    int history_r[RAY_HISTORY];
+    int history = 0;
+
+    ThingStore *store = &this->store;
+
+    float best = ray->distance;
+
+    while (enter <= best) {
+        if (c >= 0 and r >= 0 and c < this->columns and r < this->rows) {
+            Cell *cell = &this->cells[c + r * this->columns];
+            for (int i = 0; i < cell->line_count; i++) {
+                Line *ld = cell->lines[i];
+                float t = ray_line(x, z, dx, dz, ld);
+                if (t < best and filter(context, ld, NULL)) {
+                    best = t;
+                    hit->line = ld;
+                    hit->thing = NULL;
+                }
+            }
+        }
+
+        int n_min = r > reach ? r - reach : 0;
+        int n_max = r < this->rows - 1 - reach ? r + reach : this->rows - 1;
+        int m_min = c > reach ? c - reach : 0;
+        int m_max = c < this->columns - 1 - reach ? c + reach : this->columns - 1;
+
+        for (int n = n_min; n <= n_max; n++) {
+            for (int m = m_min; m <= m_max; m++) {
+                if (ray_seen(m, n, reach, history_c, history_r, history))
+                    continue;
+                Cell *neighbor = &this->cells[m + n * this->columns];
+                for (int k = neighbor->thing_head; k != -1; k = store->next[k]) {
+                    float t = ray_box(x, z, inverse_x, inverse_z, store->x[k], store->z[k], store->box[k]);
+                    if (t < best and filter(context, NULL, this->things[k])) {
+                        best = t;
+                        hit->line = NULL;
+                        hit->thing = this->things[k];
+                    }
+                }
+            }
+        }
+
+        if (history == RAY_HISTORY) {
+            for (int h = 1; h < RAY_HISTORY; h++) {
+                history_c[h - 1] = history_c[h];
+                history_r[h - 1] = history_r[h];
+            }
+            history--;
+        }
+        history_c[history] = c;
+        history_r[history] = r;
+        history++;
+
+        if (next_c < next_r) {
+            enter = next_c;
+            next_c += delta_c;
+            c += step_c;
+            if (c < -1 or c > this->columns)
+                break;
+        } else {
+            enter = next_r;
+            next_r += delta_r;
+            r += step_r;
+            if (r < -1 or r > this->rows)
+                break;
+        }
+    }
+
+    hit->distance = best;
+    hit->x = x + dx * best;
+    hit->z = z + dz * best;
+
+    return hit->line != NULL or hit->thing != NULL;
+}
+
+static void raycast_batch_task(void *context, int job, int worker) {
+    (void)worker;
+    RayBatch *batch = context;
+    int begin = job * RAY_BATCH;
+    int end = begin + RAY_BATCH;
+    if (end > batch->count) {
+        end = batch->count;
+    }
+    for (int i = begin; i < end; i++) {
+        world_raycast(batch->map, &batch->rays[i], batch->filter, batch->context, &batch->hits[i]);
+    }
+}
+
+void world_raycast_batch(World *this, Ray *rays, int count, RayFilter filter, void *context, RayHit *hits) {
+    RayBatch batch = {this, rays, count, filter, context, hits};
+    int jobs = (count + RAY_BATCH - 1) / RAY_BATCH;
+    worker_pool_run(this->workers, raycast_batch_task, &batch, jobs);
+}
@@ -0,0 +1,265 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "render.h"
+
+#define RENDER_NEAR 0.01f
+#define RENDER_CLIP_MAX 8
+#define RENDER_DEFAULT_COLOR 0xa0a0a0
+
+typedef struct Render Render;
+typedef struct RenderVertex RenderVertex;
+typedef struct RenderPoint RenderPoint;
+
+struct Render {
+    Canvas *canvas;
+    World *world;
+    Assets *assets;
+    float *projection;
+};
+
+struct RenderVertex {
+    float x;
+    float y;
+    float z;
+    float u;
+    float v;
+    float s;
+    float t;
+    float cx;
+    float cy;
+    float cw;
+};
+
+struct RenderPoint {
+    CanvasVertex screen;
+    float x;
+    float y;
+    float z;
+};
+
+static RenderVertex vertex_lerp(RenderVertex *a, RenderVertex *b, float t) {
+    RenderVertex out;
+    out.x = a->x + (b->x - a->x) * t;
+    out.y = a->y + (b->y - a->y) * t;
+    out.z = a->z + (b->z - a->z) * t;
+    out.u = a->u + (b->u - a->u) * t;
+    out.v = a->v + (b->v - a->v) * t;
+    out.s = a->s + (b->s - a->s) * t;
+    out.t = a->t + (b->t - a->t) * t;
+    out.cx = a->cx + (b->cx - a->cx) * t;
+    out.cy = a->cy + (b->cy - a->cy) * t;
+    out.cw = a->cw + (b->cw - a->cw) * t;
+    return out;
+}
+
+static RenderPoint point_lerp(RenderPoint *a, RenderPoint *b, float t) {
+    RenderPoint out;
+    out.screen.x = a->screen.x + (b->screen.x - a->screen.x) * t;
+    out.screen.y = a->screen.y + (b->screen.y - a->screen.y) * t;
+    out.screen.w = a->screen.w + (b->screen.w - a->screen.w) * t;
+    out.screen.u = a->screen.u + (b->screen.u - a->screen.u) * t;
+    out.screen.v = a->screen.v + (b->screen.v - a->screen.v) * t;
+    out.screen.s = a->screen.s + (b->screen.s - a->screen.s) * t;
+    out.screen.t = a->screen.t + (b->screen.t - a->screen.t) * t;
+    out.screen.light = 0.0f;
+    out.x = a->x + (b->x - a->x) * t;
+    out.y = a->y + (b->y - a->y) * t;
+    out.z = a->z + (b->z - a->z) * t;
+    return out;
+}
+
+static void render_transform(Render *render, RenderVertex *vertex) {
+    float *m = render->projection;
+    float x = vertex->x;
+    float y = vertex->y;
+    float z = vertex->z;
+    vertex->cx = x * m[0] + y * m[4] + z * m[8] + m[12];
+    vertex->cy = x * m[1] + y * m[5] + z * m[9] + m[13];
+    vertex->cw = x * m[3] + y * m[7] + z * m[11] + m[15];
+}
+
+static int render_clip(RenderVertex *in, int count, RenderVertex *out) {
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        RenderVertex *a = &in[i];
+        RenderVertex *b = &in[(i + 1) % count];
+        bool a_inside = a->cw >= RENDER_NEAR;
+        bool b_inside = b->cw >= RENDER_NEAR;
+        if (a_inside) {
+            out[n++] = *a;
+        }
+        if (a_inside != b_inside) {
+            out[n++] = vertex_lerp(a, b, (RENDER_NEAR - a->cw) / (b->cw - a->cw));
+        }
+    }
+    return n;
+}
+
+static void render_project(Render *render, RenderVertex *vertex, RenderPoint *point) {
+    Canvas *canvas = render->canvas;
+    float inverse = 1.0f / vertex->cw;
+    point->screen.x = (vertex->cx * inverse * 0.5f + 0.5f) * (float)canvas->width;
+    point->screen.y = (0.5f - vertex->cy * inverse * 0.5f) * (float)canvas->height;
+    point->screen.w = inverse;
+    point->screen.u = vertex->u * inverse;
+    point->screen.v = vertex->v * inverse;
+    point->screen.s = vertex->s * inverse;
+    point->screen.t = vertex->t * inverse;
+    point->screen.light = 0.0f;
+    point->x = vertex->x * inverse;
+    point->y = vertex->y * inverse;
+    point->z = vertex->z * inverse;
+}
+
+static void render_light(Render *render, RenderPoint *point, float ambient) {
+    float depth = 1.0f / point->screen.w;
+    point->screen.light = ambient + world_dynamic_light(render->world, point->x * depth, point->y * depth, point->z * depth);
+}
+
+static float point_major(RenderPoint *point, bool columns) {
+    return columns ? point->screen.x : point->screen.y;
+}
+
+static float point_minor(RenderPoint *point, bool columns) {
+    return columns ? point->screen.y : point->screen.x;
+}
+
+static void render_scan(Render *render, CanvasSurface *surface, float ambient, RenderPoint *points, int count, bool columns) {
+    Canvas *canvas = render->canvas;
+
+    float low = FLT_MAX;
+    float high = -FLT_MAX;
+    for (int i = 0; i < count; i++) {
+        float major = point_major(&points[i], columns);
+        low = fminf(low, major);
+        high = fmaxf(high, major);
+    }
+
+    i32 limit = columns ? canvas->width : canvas->height;
+    i32 first = max32((i32)ceilf(low - 0.5f), 0);
+    i32 last = min32((i32)ceilf(high - 0.5f), limit);
+
+    for (i32 line = first; line < last; line++) {
+        float center = (float)line + 0.5f;
+
+        RenderPoint near;
+        RenderPoint far;
+        int found = 0;
+
+        for (int i = 0; i < count; i++) {
+            RenderPoint *a = &points[i];
+            RenderPoint *b = &points[(i + 1) % count];
+            float pa = point_major(a, columns);
+            float pb = point_major(b, columns);
+            if ((center < pa or center >= pb) and (center < pb or center >= pa)) {
+                continue;
+            }
+            RenderPoint hit = point_lerp(a, b, (center - pa) / (pb - pa));
+            if (found == 0) {
+                near = hit;
+                far = hit;
+            } else if (point_minor(&hit, columns) < point_minor(&near, columns)) {
+                near = hit;
+            } else if (point_minor(&hit, columns) > point_minor(&far, columns)) {
+                far = hit;
+            }
+            found++;
+        }
+
+        if (found < 2) {
+            continue;
+        }
+
+        render_light(render, &near, ambient);
+        render_light(render, &far, ambient);
+
+        if (columns) {
+            canvas_shade_column(canvas, surface, line, &near.screen, &far.screen);
+        } else {
+            canvas_shade_span(canvas, surface, line, &near.screen, &far.screen);
+        }
+    }
+}
+
+static void render_polygon(Render *render, CanvasSurface *surface, float ambient, RenderVertex *vertices, int count, bool columns) {
+    for (int i = 0; i < count; i++) {
+        render_transform(render, &vertices[i]);
+    }
+
+    RenderVertex clipped[RENDER_CLIP_MAX];
+    count = render_clip(vertices, count, clipped);
+    if (count < 3) {
+        return;
+    }
+
+    RenderPoint points[RENDER_CLIP_MAX];
+    for (int i = 0; i < count; i++) {
+        render_project(render, &clipped[i], &points[i]);
+    }
+
+    render_scan(render, surface, ambient, points, count, columns);
+}
+
+static void render_surface(Render *render, CanvasSurface *surface, int texture, Lightmap *lightmap) {
+    surface->paint = texture >= 0 ? assets_paint_get(render->assets, texture) : NULL;
+    surface->color = RENDER_DEFAULT_COLOR;
+    surface->lightmap = lightmap;
+}
+
+static void render_sector(Render *render, Sector *sector) {
+    CanvasSurface surface;
+    RenderVertex vertices[3] = {0};
+
+    for (int i = 0; i < sector->triangle_count; i++) {
+        Triangle *td = sector->triangles[i];
+        Lightmap *lightmap = td->normal > 0.0f ? sector->floor_lightmap : sector->ceiling_lightmap;
+        render_surface(render, &surface, td->texture, lightmap);
+
+        vertices[0] = (RenderVertex){td->va.x, td->h1, td->va.y, td->u1, td->v1, td->s1, td->t1, 0.0f, 0.0f, 0.0f};
+        vertices[1] = (RenderVertex){td->vb.x, td->h2, td->vb.y, td->u2, td->v2, td->s2, td->t2, 0.0f, 0.0f, 0.0f};
+        vertices[2] = (RenderVertex){td->vc.x, td->h3, td->vc.y, td->u3, td->v3, td->s3, td->t3, 0.0f, 0.0f, 0.0f};
+
+        render_polygon(render, &surface, lightmap != NULL ? 0.0f : sector->light, vertices, 3, false);
+    }
+}
+
+static void render_wall(Render *render, Wall *wall) {
+    if (wall == NULL) {
+        return;
+    }
+
+    CanvasSurface surface;
+    render_surface(render, &surface, wall->texture, wall->lightmap);
+
+    Vec *a = wall->a;
+    Vec *b = wall->b;
+
+    float v = wall->v + (wall->floor_b - wall->floor) * WORLD_SCALE;
+    float t = wall->t + (wall->ceiling_b - wall->ceiling) * WORLD_SCALE;
+
+    RenderVertex vertices[4] = {
+        {a->x, wall->floor, a->y, wall->u, wall->v, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+        {b->x, wall->floor_b, b->y, wall->s, v, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+        {b->x, wall->ceiling_b, b->y, wall->s, t, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+        {a->x, wall->ceiling, a->y, wall->u, wall->t, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f},
+    };
+
+    render_polygon(render, &surface, wall->lightmap != NULL ? 0.0f : wall->light, vertices, 4, true);
+}
+
+void render_world(Canvas *canvas, World *world, Assets *assets, float *projection) {
+    Render render = {canvas, world, assets, projection};
+
+    for (int i = 0; i < world->sector_count; i++) {
+        render_sector(&render, world->sectors[i]);
+    }
+
+    for (int i = 0; i < world->line_count; i++) {
+        Line *ld = world->lines[i];
+        render_wall(&render, ld->bottom);
+        render_wall(&render, ld->middle);
+        render_wall(&render, ld->top);
+    }
+}
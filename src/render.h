@@ -0,0 +1,15 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "assets.h"
+#include "canvas.h"
+#include "pie.h"
+#include "world.h"
+
+void render_world(Canvas *canvas, World *world, Assets *assets, float *projection);
+
+#endif
@@ -0,0 +1,240 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "replay.h"
+
+static u64 hash_words(u64 hash, void *data, int count) {
+    u32 *words = data;
+    for (int i = 0; i < count; i++) {
+        hash ^= words[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+static u64 hash_bytes(u64 hash, u8 *bytes, int count) {
+    for (int i = 0; i < count; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+u64 world_state_hash(World *this) {
+    ThingStore *store = &this->store;
+    int count = this->thing_count;
+
+    u64 hash = 0xcbf29ce484222325;
+    hash = hash_words(hash, &this->tick, 1);
+    hash = hash_words(hash, &count, 1);
+
+    for (int i = 0; i < count; i++) {
+        Thing *t = this->things[i];
+        hash = hash_words(hash, &t->id, 1);
+        hash = hash_words(hash, &t->health, 1);
+    }
+
+    hash = hash_words(hash, store->x, count);
+    hash = hash_words(hash, store->y, count);
+    hash = hash_words(hash, store->z, count);
+    hash = hash_words(hash, store->dx, count);
+    hash = hash_words(hash, store->dy, count);
+    hash = hash_words(hash, store->dz, count);
+    hash = hash_bytes(hash, store->ground, count);
+    hash = hash_bytes(hash, store->rest, count);
+    hash = hash_words(hash, this->thing_awake_end, THING_TYPE_COUNT);
+    hash = hash_words(hash, this->thing_type_end, THING_TYPE_COUNT);
+
+    ParticlePool *particles = &this->particles;
+    hash = hash_words(hash, &particles->count, 1);
+    hash = hash_words(hash, &particles->seed, 1);
+    hash = hash_words(hash, particles->x, particles->count);
+    hash = hash_words(hash, particles->y, particles->count);
+    hash = hash_words(hash, particles->z, particles->count);
+    hash = hash_words(hash, particles->dx, particles->count);
+    hash = hash_words(hash, particles->dy, particles->count);
+    hash = hash_words(hash, particles->dz, particles->count);
+    hash = hash_words(hash, particles->life, particles->count);
+
+    for (int i = 0; i < this->sector_count; i++) {
+        Sector *s = this->sectors[i];
+        hash = hash_words(hash, &s->floor, 1);
+        hash = hash_words(hash, &s->ceiling, 1);
+        hash = hash_words(hash, &s->floor_plane, 3);
+        hash = hash_words(hash, &s->ceiling_plane, 3);
+    }
+
+    hash = hash_words(hash, &this->mover_count, 1);
+    for (int i = 0; i < this->mover_count; i++) {
+        SectorMover *mover = &this->movers[i];
+        hash = hash_words(hash, &mover->sec->id, 1);
+        hash = hash_words(hash, &mover->floor, 1);
+        hash = hash_words(hash, &mover->ceiling, 1);
+        hash = hash_words(hash, &mover->speed, 1);
+    }
+
+    return hash;
+}
+
+static u32 replay_pack(Input *input) {
+    bool buttons[] = {
+        input->mouse_down,
+        input->move_left,
+        input->move_right,
+        input->move_up,
+        input->move_down,
+        input->move_forward,
+        input->move_backward,
+        input->look_up,
+        input->look_down,
+        input->look_left,
+        input->look_right,
+        input->console,
+        input->debug,
+    };
+    u32 packed = 0;
+    for (u32 i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+        packed |= (u32)buttons[i] << i;
+    }
+    return packed;
+}
+
+static void replay_unpack(u32 packed, Input *input) {
+    bool *buttons[] = {
+        &input->mouse_down,
+        &input->move_left,
+        &input->move_right,
+        &input->move_up,
+        &input->move_down,
+        &input->move_forward,
+        &input->move_backward,
+        &input->look_up,
+        &input->look_down,
+        &input->look_left,
+        &input->look_right,
+        &input->console,
+        &input->debug,
+    };
+    for (u32 i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+        *buttons[i] = (packed >> i) & 1;
+    }
+}
+
+Replay *new_replay(World *world) {
+    Replay *this = safe_calloc(1, sizeof(Replay));
+    if (world != NULL) {
+        world_snapshot(world, &this->start);
+    }
+    return this;
+}
+
+bool replay_begin(Replay *this, World *world) {
+    this->cursor = 0;
+    this->desyncs = 0;
+    return this->start.size == 0 or world_restore(world, &this->start);
+}
+
+void replay_record(Replay *this, Input *input, u64 hash) {
+    if (this->count == this->cap) {
+        this->cap = this->cap == 0 ? 256 : this->cap * 2;
+        this->frames = safe_realloc(this->frames, this->cap * sizeof(ReplayFrame));
+    }
+    ReplayFrame *frame = &this->frames[this->count++];
+    frame->buttons = replay_pack(input);
+    frame->mouse_x = input->mouse_x;
+    frame->mouse_y = input->mouse_y;
+    frame->hash = hash;
+}
+
+bool replay_next(Replay *this, Input *input, u64 *hash) {
+    if (this->cursor >= this->count) {
+        return false;
+    }
+    ReplayFrame *frame = &this->frames[this->cursor++];
+    replay_unpack(frame->buttons, input);
+    input->mouse_x = frame->mouse_x;
+    input->mouse_y = frame->mouse_y;
+    *hash = frame->hash;
+    return true;
+}
+
+bool replay_save(Replay *this, char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    u32 magic = REPLAY_MAGIC;
+    u32 version = REPLAY_VERSION;
+    i32 count = this->count;
+
+    bool ok = fwrite(&magic, sizeof(u32), 1, fp) == 1 and fwrite(&version, sizeof(u32), 1, fp) == 1 and fwrite(&count, sizeof(i32), 1, fp) == 1;
+    ok = ok and fwrite(this->frames, sizeof(ReplayFrame), count, fp) == (usize)count;
+
+    u64 start = this->start.size;
+    ok = ok and fwrite(&start, sizeof(u64), 1, fp) == 1;
+    ok = ok and fwrite(this->start.data, sizeof(u8), this->start.size, fp) == this->start.size;
+
+    fclose(fp);
+    return ok;
+}
+
+static u64 replay_remaining(FILE *fp, long size, u64 reserve) {
+    long position = ftell(fp);
+    if (position < 0 or position > size or (u64)(size - position) < reserve) {
+        return 0;
+    }
+    return (u64)(size - position) - reserve;
+}
+
+Replay *replay_load(char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    long size = fseek(fp, 0, SEEK_END) == 0 ? ftell(fp) : -1;
+
+    u32 magic = 0;
+    u32 version = 0;
+    i32 count = 0;
+
+    bool ok = size >= 0 and fseek(fp, 0, SEEK_SET) == 0;
+    ok = ok and fread(&magic, sizeof(u32), 1, fp) == 1 and fread(&version, sizeof(u32), 1, fp) == 1 and fread(&count, sizeof(i32), 1, fp) == 1;
+    ok = ok and magic == REPLAY_MAGIC and version == REPLAY_VERSION and count >= 0;
+    ok = ok and (u64)count <= replay_remaining(fp, size, sizeof(u64)) / sizeof(ReplayFrame);
+
+    Replay *this = NULL;
+    if (ok) {
+        this = new_replay(NULL);
+        this->cap = count + 1;
+        this->frames = safe_malloc(this->cap * sizeof(ReplayFrame));
+        this->count = count;
+        ok = fread(this->frames, sizeof(ReplayFrame), count, fp) == (usize)count;
+
+        u64 start = 0;
+        ok = ok and fread(&start, sizeof(u64), 1, fp) == 1;
+        ok = ok and start <= replay_remaining(fp, size, 0);
+        if (ok and start > 0) {
+            this->start.data = safe_malloc(start);
+            this->start.size = start;
+            this->start.cap = start;
+            ok = fread(this->start.data, sizeof(u8), start, fp) == start;
+        }
+
+        if (!ok) {
+            replay_delete(this);
+            this = NULL;
+        }
+    }
+
+    fclose(fp);
+    return this;
+}
+
+void replay_delete(Replay *this) {
+    snapshot_release(&this->start);
+    free(this->frames);
+    free(this);
+}
@@ -0,0 +1,48 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+
+#include "input.h"
+#include "mem.h"
+#include "pie.h"
+#include "snapshot.h"
+#include "world.h"
+
+#define REPLAY_MAGIC 0x59414c50
+#define REPLAY_VERSION 2
+
+typedef struct ReplayFrame ReplayFrame;
+typedef struct Replay Replay;
+
+struct ReplayFrame {
+    u32 buttons;
+    i32 mouse_x;
+    i32 mouse_y;
+    u64 hash;
+};
+
+struct Replay {
+    ReplayFrame *frames;
+    int count;
+    int cap;
+    int cursor;
+    int desyncs;
+    Snapshot start;
+};
+
+u64 world_state_hash(World *this);
+
+Replay *new_replay(World *world);
+bool replay_begin(Replay *this, World *world);
+void replay_record(Replay *this, Input *input, u64 hash);
+bool replay_next(Replay *this, Input *input, u64 *hash);
+bool replay_save(Replay *this, char *path);
+Replay *replay_load(char *path);
+void replay_delete(Replay *this);
+
+#endif
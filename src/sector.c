@@ -19,6 +19,8 @@ Sector *new_sector(Vec **vecs, int vec_count, Line **lines, int line_count, floa
     s->top = top;
     s->floor_paint = floor_paint;
     s->ceiling_paint = ceiling_paint;
+    s->light = SECTOR_DEFAULT_LIGHT;
+    sector_update_planes(s);
     return s;
 }
 
@@ -55,6 +57,29 @@ Sector *sector_find(Sector *this, float x, float y) {
     return this;
 }
 
+void sector_set_slope(Sector *this, float anchor_x, float anchor_z, float floor_x, float floor_z, float ceiling_x, float ceiling_z) {
+    this->anchor_x = anchor_x;
+    this->anchor_z = anchor_z;
+    this->floor_plane.x = floor_x;
+    this->floor_plane.z = floor_z;
+    this->ceiling_plane.x = ceiling_x;
+    this->ceiling_plane.z = ceiling_z;
+    sector_update_planes(this);
+}
+
+void sector_update_planes(Sector *this) {
+    this->floor_plane.d = this->floor - this->floor_plane.x * this->anchor_x - this->floor_plane.z * this->anchor_z;
+    this->ceiling_plane.d = this->ceiling - this->ceiling_plane.x * this->anchor_x - this->ceiling_plane.z * this->anchor_z;
+}
+
+float sector_floor_at(Sector *this, float x, float z) {
+    return this->floor_plane.d + (this->floor_plane.x * x + this->floor_plane.z * z);
+}
+
+float sector_ceiling_at(Sector *this, float x, float z) {
+    return this->ceiling_plane.d + (this->ceiling_plane.x * x + this->ceiling_plane.z * z);
+}
+
 bool sector_has_floor(Sector *this) {
     return this->floor_paint != SECTOR_NO_SURFACE;
 }
@@ -8,6 +8,7 @@
 #include <math.h>
 
 #include "array.h"
+#include "lightmap.h"
 #include "math_util.h"
 #include "mem.h"
 #include "triangle.h"
@@ -15,12 +16,14 @@
 
 #define LINE_NO_WALL -1
 #define SECTOR_NO_SURFACE -1
+#define SECTOR_DEFAULT_LIGHT 1.0f
 
 extern unsigned int sector_unique_id;
 
 typedef struct Line Line;
 typedef struct Wall Wall;
 typedef struct Sector Sector;
+typedef struct SectorPlane SectorPlane;
 
 struct Line {
     Sector *plus;
@@ -44,14 +47,24 @@ struct Wall {
     int texture;
     float floor;
     float ceiling;
+    float floor_b;
+    float ceiling_b;
     float u;
     float v;
     float s;
     float t;
+    float light;
+    Lightmap *lightmap;
 };
 
 Wall *new_wall(Vec *a, Vec *b, int texture);
-void wall_set(Wall *this, float floor, float ceiling, float u, float v, float s, float t);
+void wall_set(Wall *this, float floor, float ceiling, float floor_b, float ceiling_b, float u, float v, float s, float t);
+
+struct SectorPlane {
+    float x;
+    float z;
+    float d;
+};
 
 struct Sector {
     unsigned int id;
@@ -63,10 +76,22 @@ struct Sector {
     float floor;
     float ceiling;
     float top;
+    float anchor_x;
+    float anchor_z;
+    SectorPlane floor_plane;
+    SectorPlane ceiling_plane;
     int floor_paint;
     int ceiling_paint;
+    float light;
+    float lightmap_x;
+    float lightmap_z;
+    Lightmap *floor_lightmap;
+    Lightmap *ceiling_lightmap;
+    bool lightmap_dirty;
     Triangle **triangles;
     int triangle_count;
+    int nav_begin;
+    int nav_count;
     Sector **inside;
     int inside_count;
     Sector *outside;
@@ -75,6 +100,10 @@ struct Sector {
 Sector *new_sector(Vec **vecs, int vec_count, Line **lines, int line_count, float bottom, float floor, float ceiling, float top, int floor_paint, int ceiling_paint);
 bool sector_contains(Sector *this, float x, float y);
 Sector *sector_find(Sector *this, float x, float y);
+void sector_set_slope(Sector *this, float anchor_x, float anchor_z, float floor_x, float floor_z, float ceiling_x, float ceiling_z);
+void sector_update_planes(Sector *this);
+float sector_floor_at(Sector *this, float x, float z);
+float sector_ceiling_at(Sector *this, float x, float z);
 bool sector_has_floor(Sector *this);
 bool sector_has_ceiling(Sector *this);
 void sector_inside_outside(Sector **sectors, int sector_count);
@@ -0,0 +1,468 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "snapshot.h"
+
+typedef struct SnapshotHeader SnapshotHeader;
+typedef struct SnapshotThing SnapshotThing;
+typedef struct SnapshotMover SnapshotMover;
+typedef struct SnapshotSector SnapshotSector;
+typedef struct SnapshotReader SnapshotReader;
+
+struct SnapshotHeader {
+    u32 magic;
+    u32 version;
+    i32 thing_count;
+    i32 sector_count;
+    i32 cell_count;
+    i32 mover_count;
+    i32 particle_count;
+    u32 particle_seed;
+    u32 tick;
+    u32 thing_next_id;
+    i32 thing_type_end[THING_TYPE_COUNT];
+    i32 thing_awake_end[THING_TYPE_COUNT];
+    float thing_box_max;
+    i32 focus;
+};
+
+struct SnapshotThing {
+    u32 id;
+    i32 type;
+    i32 sector;
+    i32 health;
+    float speed;
+    float rotation;
+    float rotation_target;
+    i32 sprite_id;
+};
+
+struct SnapshotSector {
+    float floor;
+    float ceiling;
+    float anchor_x;
+    float anchor_z;
+    float floor_x;
+    float floor_z;
+    float ceiling_x;
+    float ceiling_z;
+};
+
+struct SnapshotMover {
+    i32 sector;
+    float floor;
+    float ceiling;
+    float speed;
+    float left;
+    float bottom;
+    float right;
+    float top;
+};
+
+struct SnapshotReader {
+    u8 *data;
+    usize size;
+    usize cursor;
+};
+
+static void *snapshot_reserve(Snapshot *this, usize size) {
+    if (this->size + size > this->cap) {
+        usize cap = this->cap == 0 ? SNAPSHOT_PAGE : this->cap;
+        while (cap < this->size + size) {
+            cap *= 2;
+        }
+        this->data = safe_realloc(this->data, cap);
+        this->cap = cap;
+    }
+    void *at = this->data + this->size;
+    this->size += size;
+    return at;
+}
+
+static void snapshot_write(Snapshot *this, void *data, usize size) {
+    memcpy(snapshot_reserve(this, size), data, size);
+}
+
+static bool snapshot_read(SnapshotReader *this, void *data, usize size) {
+    if (this->cursor + size > this->size) {
+        return false;
+    }
+    memcpy(data, this->data + this->cursor, size);
+    this->cursor += size;
+    return true;
+}
+
+static int sector_index(World *this, Sector *sec) {
+    if (sec == NULL) {
+        return -1;
+    }
+    int low = 0;
+    int high = this->sector_count - 1;
+    while (low <= high) {
+        int mid = (low + high) >> 1;
+        unsigned int id = this->sectors[mid]->id;
+        if (id == sec->id) {
+            return mid;
+        } else if (id < sec->id) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    for (int i = 0; i < this->sector_count; i++) {
+        if (this->sectors[i] == sec) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void world_snapshot(World *this, Snapshot *snapshot) {
+    snapshot->size = 0;
+
+    int count = this->thing_count;
+    ThingStore *store = &this->store;
+    ParticlePool *particles = &this->particles;
+
+    SnapshotHeader *header = snapshot_reserve(snapshot, sizeof(SnapshotHeader));
+    memset(header, 0, sizeof(SnapshotHeader));
+    header->magic = SNAPSHOT_MAGIC;
+    header->version = SNAPSHOT_VERSION;
+    header->thing_count = count;
+    header->sector_count = this->sector_count;
+    header->cell_count = this->cell_count;
+    header->mover_count = this->mover_count;
+    header->particle_count = particles->count;
+    header->particle_seed = particles->seed;
+    header->tick = this->tick;
+    header->thing_next_id = this->thing_next_id;
+    for (int i = 0; i < THING_TYPE_COUNT; i++) {
+        header->thing_type_end[i] = this->thing_type_end[i];
+        header->thing_awake_end[i] = this->thing_awake_end[i];
+    }
+    header->thing_box_max = this->thing_box_max;
+    header->focus = this->focus != NULL ? this->focus->index : -1;
+
+    SnapshotThing *things = snapshot_reserve(snapshot, count * sizeof(SnapshotThing));
+    for (int i = 0; i < count; i++) {
+        Thing *t = this->things[i];
+        SnapshotThing *out = &things[i];
+        out->id = t->id;
+        out->type = (i32)t->type;
+        out->sector = sector_index(this, t->sec);
+        out->health = t->health;
+        out->speed = t->speed;
+        out->rotation = t->rotation;
+        out->rotation_target = t->rotation_target;
+        out->sprite_id = t->sprite_id;
+    }
+
+    usize floats = count * sizeof(float);
+    snapshot_write(snapshot, store->x, floats);
+    snapshot_write(snapshot, store->y, floats);
+    snapshot_write(snapshot, store->z, floats);
+    snapshot_write(snapshot, store->dx, floats);
+    snapshot_write(snapshot, store->dy, floats);
+    snapshot_write(snapshot, store->dz, floats);
+    snapshot_write(snapshot, store->previous_x, floats);
+    snapshot_write(snapshot, store->previous_z, floats);
+    snapshot_write(snapshot, store->box, floats);
+    snapshot_write(snapshot, store->height, floats);
+    snapshot_write(snapshot, store->floor, floats);
+    snapshot_write(snapshot, store->cell, count * sizeof(int));
+    snapshot_write(snapshot, store->next, count * sizeof(int));
+    snapshot_write(snapshot, store->previous, count * sizeof(int));
+    snapshot_write(snapshot, store->ground, count * sizeof(u8));
+    snapshot_write(snapshot, store->rest, count * sizeof(u8));
+    snapshot_write(snapshot, store->step, count * sizeof(u8));
+    snapshot_write(snapshot, store->phase, count * sizeof(u8));
+
+    for (int i = 0; i < this->cell_count; i++) {
+        Cell *cell = &this->cells[i];
+        i32 links[2] = {cell->thing_head, cell->thing_count};
+        snapshot_write(snapshot, links, sizeof(links));
+    }
+
+    for (int i = 0; i < this->sector_count; i++) {
+        Sector *sec = this->sectors[i];
+        SnapshotSector out = {sec->floor, sec->ceiling, sec->anchor_x, sec->anchor_z, sec->floor_plane.x, sec->floor_plane.z, sec->ceiling_plane.x, sec->ceiling_plane.z};
+        snapshot_write(snapshot, &out, sizeof(SnapshotSector));
+    }
+
+    for (int i = 0; i < this->mover_count; i++) {
+        SectorMover *mover = &this->movers[i];
+        SnapshotMover out = {sector_index(this, mover->sec), mover->floor, mover->ceiling, mover->speed, mover->left, mover->bottom, mover->right, mover->top};
+        snapshot_write(snapshot, &out, sizeof(SnapshotMover));
+    }
+
+    usize particle_floats = particles->count * sizeof(float);
+    snapshot_write(snapshot, particles->x, particle_floats);
+    snapshot_write(snapshot, particles->y, particle_floats);
+    snapshot_write(snapshot, particles->z, particle_floats);
+    snapshot_write(snapshot, particles->dx, particle_floats);
+    snapshot_write(snapshot, particles->dy, particle_floats);
+    snapshot_write(snapshot, particles->dz, particle_floats);
+    snapshot_write(snapshot, particles->floor, particle_floats);
+    snapshot_write(snapshot, particles->ceiling, particle_floats);
+    snapshot_write(snapshot, particles->life, particle_floats);
+    snapshot_write(snapshot, particles->texture, particles->count * sizeof(int));
+}
+
+bool world_restore(World *this, Snapshot *snapshot) {
+    SnapshotReader reader = {snapshot->data, snapshot->size, 0};
+
+    SnapshotHeader header;
+    if (!snapshot_read(&reader, &header, sizeof(SnapshotHeader))) {
+        return false;
+    }
+    if (header.magic != SNAPSHOT_MAGIC or header.version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    if (header.sector_count != this->sector_count or header.cell_count != this->cell_count) {
+        return false;
+    }
+    if (header.thing_count < 0 or header.mover_count < 0 or header.particle_count < 0 or header.particle_count > PARTICLE_CAPACITY) {
+        return false;
+    }
+
+    int count = header.thing_count;
+    usize size = sizeof(SnapshotHeader) + count * (sizeof(SnapshotThing) + 11 * sizeof(float) + 3 * sizeof(int) + 4 * sizeof(u8));
+    size += this->cell_count * 2 * sizeof(i32) + this->sector_count * sizeof(SnapshotSector);
+    size += header.mover_count * sizeof(SnapshotMover) + header.particle_count * (9 * sizeof(float) + sizeof(int));
+    if (size != snapshot->size) {
+        return false;
+    }
+
+    unsigned int ids = header.thing_next_id > this->thing_next_id ? header.thing_next_id : this->thing_next_id;
+    Thing **by_id = safe_calloc(ids + 1, sizeof(Thing *));
+    for (int i = 0; i < this->thing_count; i++) {
+        Thing *t = this->things[i];
+        if (t->id < ids) {
+            by_id[t->id] = t;
+        }
+    }
+
+    thing_store_reserve(this, count + 1);
+
+    SnapshotThing *things = (SnapshotThing *)(reader.data + reader.cursor);
+    reader.cursor += count * sizeof(SnapshotThing);
+
+    for (int i = 0; i < count; i++) {
+        SnapshotThing *in = &things[i];
+        Thing *t = NULL;
+        if (in->id < ids) {
+            t = by_id[in->id];
+            by_id[in->id] = NULL;
+        }
+        if (t == NULL) {
+            t = safe_calloc(1, sizeof(Thing));
+        }
+        t->id = in->id;
+        t->type = (enum ThingType)in->type;
+        t->index = i;
+        t->sweep_slot = i;
+        t->sprite_slot = i;
+        t->map = this;
+        t->sec = in->sector >= 0 and in->sector < this->sector_count ? this->sectors[in->sector] : NULL;
+        t->health = in->health;
+        t->speed = in->speed;
+        t->rotation = in->rotation;
+        t->rotation_target = in->rotation_target;
+        t->sprite_id = in->sprite_id;
+        this->things[i] = t;
+    }
+
+    for (unsigned int i = 0; i < ids; i++) {
+        Thing *dropped = by_id[i];
+        if (dropped != NULL) {
+            if (this->navmesh != NULL) {
+                navmesh_forget(this->navmesh, dropped);
+            }
+            free(dropped);
+        }
+    }
+
+    free(by_id);
+
+    ThingStore *store = &this->store;
+    usize floats = count * sizeof(float);
+    snapshot_read(&reader, store->x, floats);
+    snapshot_read(&reader, store->y, floats);
+    snapshot_read(&reader, store->z, floats);
+    snapshot_read(&reader, store->dx, floats);
+    snapshot_read(&reader, store->dy, floats);
+    snapshot_read(&reader, store->dz, floats);
+    snapshot_read(&reader, store->previous_x, floats);
+    snapshot_read(&reader, store->previous_z, floats);
+    snapshot_read(&reader, store->box, floats);
+    snapshot_read(&reader, store->height, floats);
+    snapshot_read(&reader, store->floor, floats);
+    snapshot_read(&reader, store->cell, count * sizeof(int));
+    snapshot_read(&reader, store->next, count * sizeof(int));
+    snapshot_read(&reader, store->previous, count * sizeof(int));
+    snapshot_read(&reader, store->ground, count * sizeof(u8));
+    snapshot_read(&reader, store->rest, count * sizeof(u8));
+    snapshot_read(&reader, store->step, count * sizeof(u8));
+    snapshot_read(&reader, store->phase, count * sizeof(u8));
+    memset(store->touched, 0, count * sizeof(Thing *));
+
+    this->thing_count = count;
+    this->thing_next_id = header.thing_next_id;
+    for (int i = 0; i < THING_TYPE_COUNT; i++) {
+        this->thing_type_end[i] = header.thing_type_end[i];
+        this->thing_awake_end[i] = header.thing_awake_end[i];
+    }
+    this->thing_box_max = header.thing_box_max;
+    this->tick = header.tick;
+    this->focus = header.focus >= 0 and header.focus < count ? this->things[header.focus] : NULL;
+    this->focus_cell = -2;
+    this->trigger_event_count = 0;
+
+    if (this->thing_sprites_cap < count) {
+        this->thing_sprites_cap = count;
+        this->thing_sprites = safe_realloc(this->thing_sprites, count * sizeof(Thing *));
+    }
+    memcpy(this->thing_sprites, this->things, count * sizeof(Thing *));
+    this->thing_sprites_count = count;
+
+    if (this->sweep_cap < count) {
+        this->sweep_cap = count;
+        this->sweep_axis = safe_realloc(this->sweep_axis, count * sizeof(Thing *));
+    }
+    memcpy(this->sweep_axis, this->things, count * sizeof(Thing *));
+    this->sweep_count = count;
+
+    for (int i = 0; i < this->cell_count; i++) {
+        i32 links[2];
+        snapshot_read(&reader, links, sizeof(links));
+        this->cells[i].thing_head = links[0];
+        this->cells[i].thing_count = links[1];
+    }
+
+    for (int i = 0; i < this->sector_count; i++) {
+        SnapshotSector in;
+        snapshot_read(&reader, &in, sizeof(SnapshotSector));
+        Sector *sec = this->sectors[i];
+        bool sloped = sec->anchor_x != in.anchor_x or sec->anchor_z != in.anchor_z or sec->floor_plane.x != in.floor_x or sec->floor_plane.z != in.floor_z or sec->ceiling_plane.x != in.ceiling_x or sec->ceiling_plane.z != in.ceiling_z;
+        if (sloped) {
+            sector_set_slope(sec, in.anchor_x, in.anchor_z, in.floor_x, in.floor_z, in.ceiling_x, in.ceiling_z);
+        }
+        if (sloped or sec->floor != in.floor or sec->ceiling != in.ceiling) {
+            world_set_sector_heights(this, sec, in.floor, in.ceiling);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (this->things[i]->sec != NULL) {
+            thing_update_plane(this->things[i]);
+        }
+    }
+
+    this->mover_count = 0;
+    for (int i = 0; i < header.mover_count; i++) {
+        SnapshotMover in;
+        snapshot_read(&reader, &in, sizeof(SnapshotMover));
+        if (in.sector < 0 or in.sector >= this->sector_count) {
+            continue;
+        }
+        Sector *sec = this->sectors[in.sector];
+        world_move_sector(this, sec, in.floor, in.ceiling, in.speed);
+    }
+
+    ParticlePool *particles = &this->particles;
+    particles->count = header.particle_count;
+    particles->seed = header.particle_seed;
+    usize particle_floats = particles->count * sizeof(float);
+    snapshot_read(&reader, particles->x, particle_floats);
+    snapshot_read(&reader, particles->y, particle_floats);
+    snapshot_read(&reader, particles->z, particle_floats);
+    snapshot_read(&reader, particles->dx, particle_floats);
+    snapshot_read(&reader, particles->dy, particle_floats);
+    snapshot_read(&reader, particles->dz, particle_floats);
+    snapshot_read(&reader, particles->floor, particle_floats);
+    snapshot_read(&reader, particles->ceiling, particle_floats);
+    snapshot_read(&reader, particles->life, particle_floats);
+    snapshot_read(&reader, particles->texture, particles->count * sizeof(int));
+    memset(particles->dead, 0, particles->count * sizeof(u8));
+
+    return true;
+}
+
+void snapshot_delta(Snapshot *base, Snapshot *next, SnapshotDelta *delta) {
+    delta->size = next->size;
+    delta->page_count = 0;
+
+    usize pages = (next->size + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE;
+    for (usize p = 0; p < pages; p++) {
+        usize offset = p * SNAPSHOT_PAGE;
+        usize length = next->size - offset < SNAPSHOT_PAGE ? next->size - offset : SNAPSHOT_PAGE;
+        if (offset + length <= base->size and memcmp(base->data + offset, next->data + offset, length) == 0) {
+            continue;
+        }
+        if (delta->page_count == delta->page_cap) {
+            delta->page_cap = delta->page_cap == 0 ? 8 : delta->page_cap * 2;
+            delta->pages = safe_realloc(delta->pages, delta->page_cap * sizeof(u32));
+            delta->data = safe_realloc(delta->data, delta->page_cap * SNAPSHOT_PAGE);
+        }
+        delta->pages[delta->page_count] = (u32)p;
+        memcpy(delta->data + delta->page_count * SNAPSHOT_PAGE, next->data + offset, length);
+        delta->page_count++;
+    }
+}
+
+void snapshot_apply(Snapshot *base, SnapshotDelta *delta, Snapshot *out) {
+    out->size = 0;
+    snapshot_reserve(out, delta->size);
+    usize shared = base->size < delta->size ? base->size : delta->size;
+    memcpy(out->data, base->data, shared);
+    for (int i = 0; i < delta->page_count; i++) {
+        usize offset = delta->pages[i] * SNAPSHOT_PAGE;
+        usize length = delta->size - offset < SNAPSHOT_PAGE ? delta->size - offset : SNAPSHOT_PAGE;
+        memcpy(out->data + offset, delta->data + i * SNAPSHOT_PAGE, length);
+    }
+}
+
+bool snapshot_save(Snapshot *this, char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = fwrite(this->data, sizeof(u8), this->size, fp) == this->size;
+    fclose(fp);
+    return ok;
+}
+
+bool snapshot_load(Snapshot *this, char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    bool ok = length >= 0;
+    if (ok) {
+        this->size = 0;
+        snapshot_reserve(this, (usize)length);
+        ok = fread(this->data, sizeof(u8), this->size, fp) == this->size;
+    }
+    fclose(fp);
+    return ok;
+}
+
+void snapshot_release(Snapshot *this) {
+    free(this->data);
+    this->data = NULL;
+    this->size = 0;
+    this->cap = 0;
+}
+
+void snapshot_delta_release(SnapshotDelta *this) {
+    free(this->pages);
+    free(this->data);
+    this->pages = NULL;
+    this->data = NULL;
+    this->page_count = 0;
+    this->page_cap = 0;
+}
@@ -0,0 +1,47 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mem.h"
+#include "navmesh.h"
+#include "pie.h"
+#include "world.h"
+
+#define SNAPSHOT_MAGIC 0x50414e53
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_PAGE 4096
+
+typedef struct Snapshot Snapshot;
+typedef struct SnapshotDelta SnapshotDelta;
+
+struct Snapshot {
+    u8 *data;
+    usize size;
+    usize cap;
+};
+
+struct SnapshotDelta {
+    usize size;
+    u32 *pages;
+    u8 *data;
+    int page_count;
+    int page_cap;
+};
+
+void world_snapshot(World *this, Snapshot *snapshot);
+bool world_restore(World *this, Snapshot *snapshot);
+
+void snapshot_delta(Snapshot *base, Snapshot *next, SnapshotDelta *delta);
+void snapshot_apply(Snapshot *base, SnapshotDelta *delta, Snapshot *out);
+bool snapshot_save(Snapshot *this, char *path);
+bool snapshot_load(Snapshot *this, char *path);
+void snapshot_release(Snapshot *this);
+void snapshot_delta_release(SnapshotDelta *this);
+
+#endif
@@ -13,7 +13,10 @@
 #include "input.h"
 #include "matrix.h"
 #include "mem.h"
+#include "overlay.h"
 #include "pie.h"
+#include "render.h"
+#include "replay.h"
 #include "sprite.h"
 #include "string_util.h"
 #include "uint_table.h"
@@ -38,6 +41,11 @@ struct GameState {
     World *world;
     Camera *camera;
     Thing *hero;
+    enum OverlayMode overlay;
+    Replay *replay;
+    bool recording;
+    bool replaying;
+    char *replay_path;
 };
 
 struct PaintState {
@@ -56,6 +64,8 @@ GameState *new_game_state(Canvas *canvas, Input *input, Assets *assets);
 void game_state_open(GameState *this, String *content);
 void game_state_update(void *state);
 void game_state_draw(void *state);
+void game_state_record(GameState *this);
+void game_state_play(GameState *this);
 void game_state_delete(GameState *this);
 
 PaintState *new_paint_state(Canvas *canvas, Input *input, Assets *assets);
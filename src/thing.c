@@ -4,73 +4,210 @@
 
 #include "world.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 const float gravity = 0.028f;
 const float wind_resistance = 0.88f;
 
-unsigned int thing_unique_id = 0;
+static float friction_steps[THING_LOD_MAX_STEP + 1];
+
+typedef struct LineHit LineHit;
+typedef struct ThingScratch ThingScratch;
+
+struct LineHit {
+    float time;
+    float normal_x;
+    float normal_z;
+};
 
-void thing_remove_from_cells(Thing *this) {
+struct ThingScratch {
+    Thing **things;
+    float *distances;
+    int cap;
+    LineHit *hits;
+    int hit_cap;
+};
+
+static _Thread_local ThingScratch scratch;
+
+static void scratch_reserve(int count) {
+    if (count <= scratch.cap) {
+        return;
+    }
+    scratch.cap = count + 32;
+    scratch.things = safe_realloc(scratch.things, scratch.cap * sizeof(Thing *));
+    scratch.distances = safe_realloc(scratch.distances, scratch.cap * sizeof(float));
+}
+
+static void scratch_reserve_hits(int count) {
+    if (count <= scratch.hit_cap) {
+        return;
+    }
+    scratch.hit_cap = count + 16;
+    scratch.hits = safe_realloc(scratch.hits, scratch.hit_cap * sizeof(LineHit));
+}
+
+static int cell_column(World *map, float x) {
+    int c = (int)x >> WORLD_CELL_SHIFT;
+    return c < 0 ? 0 : (c >= map->columns ? map->columns - 1 : c);
+}
+
+static int cell_row(World *map, float z) {
+    int r = (int)z >> WORLD_CELL_SHIFT;
+    return r < 0 ? 0 : (r >= map->rows ? map->rows - 1 : r);
+}
+
+void thing_remove_from_cell(Thing *this) {
     World *map = this->map;
-    for (int r = this->r_min; r <= this->r_max; r++)
-        for (int c = this->c_min; c <= this->c_max; c++)
-            cell_remove_thing(&map->cells[c + r * map->columns], this);
+    ThingStore *store = &map->store;
+    cell_remove_thing(&map->cells[store->cell[this->index]], store, this->index);
+}
+
+static bool segments_cross(float ax, float az, float bx, float bz, Line *ld) {
+    float cx = ld->a->x;
+    float cz = ld->a->y;
+    float dx = ld->b->x;
+    float dz = ld->b->y;
+
+    float d1 = (dx - cx) * (az - cz) - (dz - cz) * (ax - cx);
+    float d2 = (dx - cx) * (bz - cz) - (dz - cz) * (bx - cx);
+    if ((d1 > 0.0f) == (d2 > 0.0f))
+        return false;
+
+    float d3 = (bx - ax) * (cz - az) - (bz - az) * (cx - ax);
+    float d4 = (bx - ax) * (dz - az) - (bz - az) * (dx - ax);
+    return (d3 > 0.0f) != (d4 > 0.0f);
 }
 
-void thing_add_to_cells(Thing *this) {
-    float box = this->box;
-    int c_min = (int)(this->x - box) >> WORLD_CELL_SHIFT;
-    int c_max = (int)(this->x + box) >> WORLD_CELL_SHIFT;
-    int r_min = (int)(this->z - box) >> WORLD_CELL_SHIFT;
-    int r_max = (int)(this->z + box) >> WORLD_CELL_SHIFT;
+static void thing_update_sector(Thing *this) {
+    World *map = this->map;
+    ThingStore *store = &map->store;
+    int i = this->index;
+
+    float previous_x = store->previous_x[i];
+    float previous_z = store->previous_z[i];
+    float x = store->x[i];
+    float z = store->z[i];
+
+    int c_min = cell_column(map, fminf(previous_x, x));
+    int c_max = cell_column(map, fmaxf(previous_x, x));
+    int r_min = cell_row(map, fminf(previous_z, z));
+    int r_max = cell_row(map, fmaxf(previous_z, z));
+
+    for (int r = r_min; r <= r_max; r++) {
+        for (int c = c_min; c <= c_max; c++) {
+            Cell *cell = &map->cells[c + r * map->columns];
+            for (int k = 0; k < cell->line_count; k++) {
+                if (segments_cross(previous_x, previous_z, x, z, cell->lines[k])) {
+                    Sector *sec = world_find_sector(map, x, z);
+                    if (sec != NULL) {
+                        this->sec = sec;
+                        thing_update_plane(this);
+                        store->floor[i] = sector_floor_at(sec, x, z);
+                    }
+                    return;
+                }
+            }
+        }
+    }
+}
 
+static void thing_update_cell(Thing *this) {
     World *map = this->map;
-    for (int r = r_min; r <= r_max; r++)
-        for (int c = c_min; c <= c_max; c++)
-            cell_add_thing(&map->cells[c + r * map->columns], this);
+    ThingStore *store = &map->store;
+    int i = this->index;
+    int cell = cell_column(map, store->x[i]) + cell_row(map, store->z[i]) * map->columns;
+    if (cell == store->cell[i]) {
+        return;
+    }
+    cell_remove_thing(&map->cells[store->cell[i]], store, i);
+    store->cell[i] = cell;
+    cell_add_thing(&map->cells[cell], store, i);
+}
 
-    this->c_min = c_min;
-    this->c_max = c_max;
-    this->r_min = r_min;
-    this->r_max = r_max;
+void thing_update_plane(Thing *this) {
+    ThingStore *store = &this->map->store;
+    int i = this->index;
+    SectorPlane *plane = &this->sec->floor_plane;
+    store->plane_x[i] = plane->x;
+    store->plane_z[i] = plane->z;
+    store->plane_d[i] = plane->d;
+}
+
+void thing_add_to_cell(Thing *this) {
+    World *map = this->map;
+    ThingStore *store = &map->store;
+    int i = this->index;
+    int cell = cell_column(map, store->x[i]) + cell_row(map, store->z[i]) * map->columns;
+    store->cell[i] = cell;
+    cell_add_thing(&map->cells[cell], store, i);
 }
 
 bool thing_collision(Thing *this, Thing *b) {
-    float block = this->box + b->box;
-    return !(fabs(this->x - b->x) > block or fabs(this->z - b->z) > block);
+    ThingStore *store = &this->map->store;
+    int i = this->index;
+    int k = b->index;
+    float block = store->box[i] + store->box[k];
+    return !(fabsf(store->x[i] - store->x[k]) > block or fabsf(store->z[i] - store->z[k]) > block);
 }
 
 void thing_resolve_collision(Thing *this, Thing *b) {
-    float block = this->box + b->box;
+    ThingStore *store = &this->map->store;
+    int i = this->index;
+    int k = b->index;
+
+    float block = store->box[i] + store->box[k];
 
-    if (fabs(this->x - b->x) > block or fabs(this->z - b->z) > block)
+    if (fabsf(store->x[i] - store->x[k]) > block or fabsf(store->z[i] - store->z[k]) > block)
         return;
 
-    if (fabs(this->previous_x - b->x) > fabs(this->previous_z - b->z)) {
-        if (this->previous_x - b->x < 0) {
-            this->x = b->x - block;
+    if (fabsf(store->previous_x[i] - store->x[k]) > fabsf(store->previous_z[i] - store->z[k])) {
+        if (store->previous_x[i] - store->x[k] < 0) {
+            store->x[i] = store->x[k] - block;
         } else {
-            this->x = b->x + block;
+            store->x[i] = store->x[k] + block;
         }
-        this->dx = 0.0f;
+        store->dx[i] = 0.0f;
     } else {
-        if (this->previous_z - b->z < 0) {
-            this->z = b->z - block;
+        if (store->previous_z[i] - store->z[k] < 0) {
+            store->z[i] = store->z[k] - block;
         } else {
-            this->z = b->z + block;
+            store->z[i] = store->z[k] + block;
         }
-        this->dz = 0.0f;
+        store->dz[i] = 0.0f;
     }
 }
 
+static bool thing_line_blocks(Thing *this, Line *ld) {
+    if (this->sec == ld->plus)
+        return false;
+
+    if (ld->middle != NULL or ld->plus == NULL)
+        return true;
+
+    ThingStore *store = &this->map->store;
+    int i = this->index;
+    float y = store->y[i];
+    float x = store->x[i];
+    float z = store->z[i];
+    return y + store->height[i] > sector_ceiling_at(ld->plus, x, z) or y + THING_STEP_HEIGHT < sector_floor_at(ld->plus, x, z);
+}
+
 void thing_line_collision(Thing *this, Line *ld) {
+    ThingStore *store = &this->map->store;
+    int i = this->index;
 
-    float box = this->box;
+    float box = store->box[i];
+    float x = store->x[i];
+    float z = store->z[i];
 
     float vx = ld->b->x - ld->a->x;
     float vz = ld->b->y - ld->a->y;
 
-    float wx = this->x - ld->a->x;
-    float wz = this->z - ld->a->y;
+    float wx = x - ld->a->x;
+    float wz = z - ld->a->y;
 
     float t = (wx * vx + wz * vz) / (vx * vx + vz * vz);
 
@@ -87,169 +224,620 @@ void thing_line_collision(Thing *this, Line *ld) {
     float px = ld->a->x + vx * t;
     float pz = ld->a->y + vz * t;
 
-    px -= this->x;
-    pz -= this->z;
+    px -= x;
+    pz -= z;
 
     if ((px * px + pz * pz) > box * box)
         return;
 
-    bool collision = false;
+    if (!thing_line_blocks(this, ld))
+        return;
+
+    float overlap;
+
+    float normal_x;
+    float normal_z;
+
+    if (endpoint) {
+        float ex = -px;
+        float ez = -pz;
 
-    if (ld->middle != NULL) {
-        collision = true;
+        float em = sqrtf(ex * ex + ez * ez);
+
+        ex /= em;
+        ez /= em;
+
+        overlap = sqrtf((px + box * ex) * (px + box * ex) + (pz + box * ez) * (pz + box * ez));
+
+        normal_x = ex;
+        normal_z = ez;
     } else {
-        if (this->y + this->height > ld->plus->ceiling or this->y + 1.0f < ld->plus->floor) {
-            collision = true;
+        overlap = sqrtf((px + box * ld->normal.x) * (px + box * ld->normal.x) + (pz + box * ld->normal.y) * (pz + box * ld->normal.y));
+
+        normal_x = ld->normal.x;
+        normal_z = ld->normal.y;
+    }
+
+    store->x[i] += normal_x * overlap;
+    store->z[i] += normal_z * overlap;
+}
+
+static bool sweep_endpoint(float x, float z, float dx, float dz, float box, Vec *e, LineHit *hit) {
+    float mx = x - e->x;
+    float mz = z - e->y;
+    float a = dx * dx + dz * dz;
+    float b = mx * dx + mz * dz;
+    float c = mx * mx + mz * mz - box * box;
+    if (c < 0.0f or b >= 0.0f)
+        return false;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f)
+        return false;
+    float t = (-b - sqrtf(discriminant)) / a;
+    if (t > 1.0f or t >= hit->time)
+        return false;
+    hit->time = t;
+    hit->normal_x = (mx + dx * t) / box;
+    hit->normal_z = (mz + dz * t) / box;
+    return true;
+}
+
+static bool sweep_line(float x, float z, float dx, float dz, float box, Line *ld, LineHit *hit) {
+    hit->time = 2.0f;
+
+    float nx = ld->normal.x;
+    float nz = ld->normal.y;
+    float distance = (x - ld->a->x) * nx + (z - ld->a->y) * nz;
+    if (distance < 0.0f) {
+        nx = -nx;
+        nz = -nz;
+        distance = -distance;
+    }
+
+    if (distance < box)
+        return false;
+
+    float approach = dx * nx + dz * nz;
+    if (approach < 0.0f) {
+        float t = (distance - box) / -approach;
+        if (t <= 1.0f) {
+            float vx = ld->b->x - ld->a->x;
+            float vz = ld->b->y - ld->a->y;
+            float cx = x + dx * t - nx * box - ld->a->x;
+            float cz = z + dz * t - nz * box - ld->a->y;
+            float u = (cx * vx + cz * vz) / (vx * vx + vz * vz);
+            if (u >= 0.0f and u <= 1.0f) {
+                hit->time = t;
+                hit->normal_x = nx;
+                hit->normal_z = nz;
+                return true;
+            }
         }
     }
 
-    if (collision) {
-        if (this->sec == ld->plus)
-            return;
+    bool a = sweep_endpoint(x, z, dx, dz, box, ld->a, hit);
+    bool b = sweep_endpoint(x, z, dx, dz, box, ld->b, hit);
+    return a or b;
+}
+
+static void thing_sweep_lines(Thing *this) {
+    World *map = this->map;
+    ThingStore *store = &map->store;
+    int index = this->index;
 
-        float overlap;
+    float box = store->box[index];
+    float x = store->x[index];
+    float z = store->z[index];
+    float step = (float)store->step[index];
+    float dx = store->dx[index] * step;
+    float dz = store->dz[index] * step;
 
-        float normal_x;
-        float normal_z;
+    for (int iteration = 0; iteration < 4; iteration++) {
+        int c_min = cell_column(map, fminf(x, x + dx) - box);
+        int c_max = cell_column(map, fmaxf(x, x + dx) + box);
+        int r_min = cell_row(map, fminf(z, z + dz) - box);
+        int r_max = cell_row(map, fmaxf(z, z + dz) + box);
 
-        if (endpoint) {
-            float ex = -px;
-            float ez = -pz;
+        int count = 0;
+        LineHit hit;
 
-            float em = sqrtf(ex * ex + ez * ez);
+        for (int r = r_min; r <= r_max; r++) {
+            for (int c = c_min; c <= c_max; c++) {
+                Cell *cell = &map->cells[c + r * map->columns];
+                for (int k = 0; k < cell->line_count; k++) {
+                    Line *ld = cell->lines[k];
+                    if (!sweep_line(x, z, dx, dz, box, ld, &hit) or !thing_line_blocks(this, ld))
+                        continue;
+                    scratch_reserve_hits(count + 1);
+                    int h = count - 1;
+                    while (h >= 0 and scratch.hits[h].time > hit.time) {
+                        scratch.hits[h + 1] = scratch.hits[h];
+                        h--;
+                    }
+                    scratch.hits[h + 1] = hit;
+                    count++;
+                }
+            }
+        }
 
-            ex /= em;
-            ez /= em;
+        if (count == 0)
+            break;
 
-            overlap = sqrtf((px + box * ex) * (px + box * ex) + (pz + box * ez) * (pz + box * ez));
+        float time = scratch.hits[0].time;
 
-            normal_x = ex;
-            normal_z = ez;
-        } else {
-            overlap = sqrtf((px + box * ld->normal.x) * (px + box * ld->normal.x) + (pz + box * ld->normal.y) * (pz + box * ld->normal.y));
+        x += dx * time;
+        z += dz * time;
+        dx *= 1.0f - time;
+        dz *= 1.0f - time;
 
-            normal_x = ld->normal.x;
-            normal_z = ld->normal.y;
+        for (int h = 0; h < count and scratch.hits[h].time - time < 0.0001f; h++) {
+            float nx = scratch.hits[h].normal_x;
+            float nz = scratch.hits[h].normal_z;
+            float into = dx * nx + dz * nz;
+            if (into < 0.0f) {
+                dx -= nx * into;
+                dz -= nz * into;
+            }
+            into = store->dx[index] * nx + store->dz[index] * nz;
+            if (into < 0.0f) {
+                store->dx[index] -= nx * into;
+                store->dz[index] -= nz * into;
+            }
         }
+    }
+
+    store->x[index] = x + dx;
+    store->z[index] = z + dz;
+}
+
+void thing_standard_update(Thing *this) {
+    World *map = this->map;
+    ThingStore *store = &map->store;
+    int index = this->index;
 
-        this->x += normal_x * overlap;
-        this->z += normal_z * overlap;
+    store->previous_x[index] = store->x[index];
+    store->previous_z[index] = store->z[index];
+
+    float step = (float)store->step[index];
+
+    if ((fabsf(store->dx[index]) + fabsf(store->dz[index])) * step > store->box[index]) {
+        thing_sweep_lines(this);
+    } else {
+        store->x[index] += store->dx[index] * step;
+        store->z[index] += store->dz[index] * step;
     }
+
+    float previous_x = store->previous_x[index];
+    float previous_z = store->previous_z[index];
+
+    int *partners = map->sweep_partners;
+    int partner_begin = map->sweep_offsets[index];
+    int partner_end = map->sweep_offsets[index + 1];
+
+    int thing_tests = partner_end - partner_begin;
+    int line_tests = 0;
+    int collided = 0;
+
+    map->cells[store->cell[index]].tests += thing_tests;
+
+    for (int e = partner_begin; e < partner_end; e++) {
+        int k = partners[e];
+        Thing *t = map->things[k];
+
+        if (thing_collision(this, t)) {
+            if (k >= map->thing_awake_end[t->type]) {
+                store->touched[index] = t;
+            }
+            scratch_reserve(collided + 1);
+            scratch.things[collided] = t;
+            scratch.distances[collided] = fabsf(previous_x - store->x[k]) + fabsf(previous_z - store->z[k]);
+            collided++;
+        }
+    }
+
+    for (int i = 1; i < collided; i++) {
+        Thing *t = scratch.things[i];
+        float distance = scratch.distances[i];
+        int k = i - 1;
+        while (k >= 0 and scratch.distances[k] > distance) {
+            scratch.things[k + 1] = scratch.things[k];
+            scratch.distances[k + 1] = scratch.distances[k];
+            k--;
+        }
+        scratch.things[k + 1] = t;
+        scratch.distances[k + 1] = distance;
+    }
+
+    for (int i = 0; i < collided; i++) {
+        thing_resolve_collision(this, scratch.things[i]);
+    }
+
+    float box = store->box[index];
+    int c_min = cell_column(map, store->x[index] - box);
+    int c_max = cell_column(map, store->x[index] + box);
+    int r_min = cell_row(map, store->z[index] - box);
+    int r_max = cell_row(map, store->z[index] + box);
+
+    for (int r = r_min; r <= r_max; r++) {
+        for (int c = c_min; c <= c_max; c++) {
+            Cell *current_cell = &map->cells[c + r * map->columns];
+            current_cell->tests += current_cell->line_count;
+            line_tests += current_cell->line_count;
+            for (int i = 0; i < current_cell->line_count; i++)
+                thing_line_collision(this, current_cell->lines[i]);
+        }
+    }
+
+    thing_update_cell(this);
+    thing_update_sector(this);
+    thing_update_triggers(this);
+
+    worker_counter_add(map->thing_tests, thing_tests);
+    worker_counter_add(map->line_tests, line_tests);
 }
 
-void thing_nop_update(void *this) {
-    (void *)this;
+void things_lod_init() {
+    float factor = 1.0f;
+    for (int step = 0; step <= THING_LOD_MAX_STEP; step++) {
+        friction_steps[step] = factor;
+        factor *= wind_resistance;
+    }
 }
 
-void thing_standard_update(Thing *this) {
-    if (this->ground) {
-        this->dx *= wind_resistance;
-        this->dz *= wind_resistance;
+void things_schedule(World *map, int begin, int end) {
+    ThingStore *store = &map->store;
+    u8 *restrict step = store->step;
+    u8 *restrict phase = store->phase;
+    int *restrict cell = store->cell;
+    u8 *restrict lod = map->cell_lod;
+    unsigned int tick = map->tick;
+    for (int i = begin; i < end; i++) {
+        unsigned int period = 1u << lod[cell[i]];
+        step[i] = ((tick + phase[i]) & (period - 1)) == 0 ? (u8)period : 0;
+    }
+}
+
+void things_friction(ThingStore *store, int begin, int end) {
+    float *restrict dx = store->dx;
+    float *restrict dz = store->dz;
+    u8 *restrict ground = store->ground;
+    u8 *restrict step = store->step;
+    for (int i = begin; i < end; i++) {
+        float factor = ground[i] ? friction_steps[step[i]] : 1.0f;
+        float x = dx[i] * factor;
+        float z = dz[i] * factor;
+        dx[i] = fabsf(x) < THING_REST_SPEED ? 0.0f : x;
+        dz[i] = fabsf(z) < THING_REST_SPEED ? 0.0f : z;
+    }
+}
+
+void things_ground(ThingStore *store, int begin, int end) {
+    float *restrict x = store->x;
+    float *restrict y = store->y;
+    float *restrict z = store->z;
+    float *restrict dy = store->dy;
+    float *restrict floor = store->floor;
+    float *restrict plane_x = store->plane_x;
+    float *restrict plane_z = store->plane_z;
+    float *restrict plane_d = store->plane_d;
+    u8 *restrict ground = store->ground;
+    u8 *restrict step = store->step;
+
+    int i = begin;
+
+#ifdef __SSE2__
+    const __m128 reach = _mm_set1_ps(THING_STEP_HEIGHT);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i none = _mm_setzero_si128();
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 height = _mm_add_ps(_mm_loadu_ps(plane_d + i), _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(plane_x + i), _mm_loadu_ps(x + i)), _mm_mul_ps(_mm_loadu_ps(plane_z + i), _mm_loadu_ps(z + i))));
+        __m128 py = _mm_loadu_ps(y + i);
+
+        i32 steps;
+        i32 grounds;
+        memcpy(&steps, step + i, sizeof(i32));
+        memcpy(&grounds, ground + i, sizeof(i32));
+        __m128i step_lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(steps), none), none);
+        __m128i ground_lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(grounds), none), none);
+        __m128 moving = _mm_castsi128_ps(_mm_cmpgt_epi32(step_lanes, none));
+        __m128 grounded = _mm_castsi128_ps(_mm_cmpgt_epi32(ground_lanes, none));
+
+        __m128 settle = _mm_and_ps(_mm_and_ps(moving, grounded), _mm_cmple_ps(_mm_loadu_ps(dy + i), zero));
+        __m128 contact = _mm_cmple_ps(_mm_sub_ps(py, height), reach);
+        __m128 snap = _mm_and_ps(settle, contact);
+
+        _mm_storeu_ps(floor + i, height);
+        _mm_storeu_ps(y + i, _mm_or_ps(_mm_and_ps(snap, height), _mm_andnot_ps(snap, py)));
+
+        int mask = _mm_movemask_ps(_mm_or_ps(snap, _mm_andnot_ps(settle, grounded)));
+        ground[i] = (u8)(mask & 1);
+        ground[i + 1] = (u8)((mask >> 1) & 1);
+        ground[i + 2] = (u8)((mask >> 2) & 1);
+        ground[i + 3] = (u8)((mask >> 3) & 1);
+    }
+#endif
+
+    for (; i < end; i++) {
+        float height = plane_d[i] + (plane_x[i] * x[i] + plane_z[i] * z[i]);
+        bool settle = step[i] != 0 and ground[i] != 0 and dy[i] <= 0.0f;
+        bool contact = y[i] - height <= THING_STEP_HEIGHT;
+        floor[i] = height;
+        y[i] = settle and contact ? height : y[i];
+        ground[i] = settle ? (u8)contact : ground[i];
     }
+}
 
-    if (FLOAT_NOT_ZERO(this->dx) or FLOAT_NOT_ZERO(this->dz)) {
-        this->previous_x = this->x;
-        this->previous_z = this->z;
+void things_gravity(ThingStore *store, int begin, int end) {
+    float *restrict y = store->y;
+    float *restrict dy = store->dy;
+    float *restrict floor = store->floor;
+    u8 *restrict ground = store->ground;
+    u8 *restrict step = store->step;
+    for (int i = begin; i < end; i++) {
+        float steps = (float)step[i];
+        bool active = step[i] != 0 and (ground[i] == 0 or FLOAT_NOT_ZERO(dy[i]));
+        float velocity = dy[i] - gravity * steps;
+        float position = y[i] + dy[i] * steps - gravity * steps * (steps + 1.0f) * 0.5f;
+        bool landed = position < floor[i];
+        y[i] = active ? (landed ? floor[i] : position) : y[i];
+        dy[i] = active ? (landed ? 0.0f : velocity) : dy[i];
+        ground[i] = active ? (u8)landed : ground[i];
+    }
+}
 
-        this->x += this->dx;
-        this->z += this->dz;
+static bool sweep_moving(ThingStore *store, int i) {
+    return store->step[i] != 0 and (FLOAT_NOT_ZERO(store->dx[i]) or FLOAT_NOT_ZERO(store->dz[i]));
+}
 
-        thing_remove_from_cells(this);
+static float sweep_pad(World *map, int i) {
+    return sweep_moving(&map->store, i) ? 2.0f * map->thing_box_max : 0.0f;
+}
 
-        float box = this->box;
-        int c_min = (int)(this->x - box) >> WORLD_CELL_SHIFT;
-        int c_max = (int)(this->x + box) >> WORLD_CELL_SHIFT;
-        int r_min = (int)(this->z - box) >> WORLD_CELL_SHIFT;
-        int r_max = (int)(this->z + box) >> WORLD_CELL_SHIFT;
+static float sweep_left(World *map, int i) {
+    ThingStore *store = &map->store;
+    return store->x[i] + fminf(store->dx[i] * store->step[i], 0.0f) - store->box[i] - sweep_pad(map, i);
+}
 
-        Set *collided = new_set(set_address_equal, set_address_hashcode);
-        Set *collisions = new_set(set_address_equal, set_address_hashcode);
+static float sweep_right(World *map, int i) {
+    ThingStore *store = &map->store;
+    return store->x[i] + fmaxf(store->dx[i] * store->step[i], 0.0f) + store->box[i] + sweep_pad(map, i);
+}
 
-        World *map = this->map;
+static float sweep_bottom(World *map, int i) {
+    ThingStore *store = &map->store;
+    return store->z[i] + fminf(store->dz[i] * store->step[i], 0.0f) - store->box[i] - sweep_pad(map, i);
+}
 
-        for (int r = r_min; r <= r_max; r++) {
-            for (int c = c_min; c <= c_max; c++) {
-                Cell *current_cell = &map->cells[c + r * map->columns];
-                for (int i = 0; i < current_cell->thing_count; i++) {
-                    Thing *t = current_cell->things[i];
+static float sweep_top(World *map, int i) {
+    ThingStore *store = &map->store;
+    return store->z[i] + fmaxf(store->dz[i] * store->step[i], 0.0f) + store->box[i] + sweep_pad(map, i);
+}
 
-                    if (set_has(collisions, t))
-                        continue;
+static bool sweep_before(World *map, Thing *a, Thing *b) {
+    float left_a = sweep_left(map, a->index);
+    float left_b = sweep_left(map, b->index);
+    return left_a < left_b or (left_a == left_b and a->id < b->id);
+}
 
-                    if (thing_collision(this, t))
-                        set_add(collided, t);
+void things_broadphase(World *map) {
+    ThingStore *store = &map->store;
+    Thing **axis = map->sweep_axis;
 
-                    set_add(collisions, t);
-                }
+    if (map->sweep_count > map->thing_count) {
+        int live = 0;
+        for (int i = 0; i < map->sweep_count; i++) {
+            if (axis[i] != NULL) {
+                axis[live++] = axis[i];
             }
         }
+        map->sweep_count = live;
+    }
+
+    int count = map->sweep_count;
 
-        set_delete(collisions);
+    for (int i = 1; i < count; i++) {
+        Thing *t = axis[i];
+        int k = i - 1;
+        while (k >= 0 and sweep_before(map, t, axis[k])) {
+            axis[k + 1] = axis[k];
+            k--;
+        }
+        axis[k + 1] = t;
+    }
 
-        while (set_not_empty(collided)) {
-            Thing *closest = NULL;
-            float manhattan = FLT_MAX;
+    if (map->thing_count + 1 > map->sweep_offset_cap) {
+        map->sweep_offset_cap = map->thing_cap + 1;
+        map->sweep_offsets = safe_realloc(map->sweep_offsets, map->sweep_offset_cap * sizeof(int));
+    }
 
-            SetIterator iter = new_set_iterator(collided);
-            while (set_iterator_has_next(&iter)) {
-                Thing *b = set_iterator_next(&iter);
-                float distance = fabsf(this->previous_x - b->x) + fabsf(this->previous_z - b->z);
-                if (distance < manhattan) {
-                    manhattan = distance;
-                    closest = b;
-                }
+    int *offsets = map->sweep_offsets;
+    memset(offsets, 0, (map->thing_count + 1) * sizeof(int));
+
+    int pair_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        axis[i]->sweep_slot = i;
+        int a = axis[i]->index;
+        bool moving = sweep_moving(store, a);
+        float right = sweep_right(map, a);
+        float bottom = sweep_bottom(map, a);
+        float top = sweep_top(map, a);
+        for (int j = i + 1; j < count; j++) {
+            int b = axis[j]->index;
+            if (sweep_left(map, b) > right)
+                break;
+            bool other = sweep_moving(store, b);
+            if (!moving and !other)
+                continue;
+            if (sweep_bottom(map, b) > top or sweep_top(map, b) < bottom)
+                continue;
+            if (pair_count == map->sweep_pair_cap) {
+                map->sweep_pair_cap = map->sweep_pair_cap == 0 ? 64 : map->sweep_pair_cap * 2;
+                map->sweep_pairs = safe_realloc(map->sweep_pairs, map->sweep_pair_cap * 2 * sizeof(int));
             }
+            int *pair = &map->sweep_pairs[pair_count * 2];
+            pair[0] = a;
+            pair[1] = b;
+            pair_count++;
+            if (moving) offsets[a]++;
+            if (other) offsets[b]++;
+        }
+    }
 
-            thing_resolve_collision(this, closest);
+    int total = 0;
+    for (int i = 0; i < map->thing_count; i++) {
+        int size = offsets[i];
+        offsets[i] = total;
+        total += size;
+    }
+    offsets[map->thing_count] = total;
 
-            set_remove(collided, closest);
-        }
+    if (total > map->sweep_partner_cap) {
+        map->sweep_partner_cap = total + 64;
+        map->sweep_partners = safe_realloc(map->sweep_partners, map->sweep_partner_cap * sizeof(int));
+    }
 
-        set_delete(collided);
+    int *partners = map->sweep_partners;
 
-        for (int r = r_min; r <= r_max; r++) {
-            for (int c = c_min; c <= c_max; c++) {
-                Cell *current_cell = &this->map->cells[c + r * this->map->columns];
-                for (int i = 0; i < current_cell->line_count; i++)
-                    thing_line_collision(this, current_cell->lines[i]);
+    // A pair where both things move is listed for both. Each mover resolves against the other's position when it moves,
+    // so the second mover sees the first one's push instead of walking into it. A pair can therefore be resolved twice.
+
+    for (int p = 0; p < pair_count; p++) {
+        int a = map->sweep_pairs[p * 2];
+        int b = map->sweep_pairs[p * 2 + 1];
+        if (sweep_moving(store, a)) partners[offsets[a]++] = b;
+        if (sweep_moving(store, b)) partners[offsets[b]++] = a;
+    }
+
+    for (int i = map->thing_count; i > 0; i--) {
+        offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+}
+
+static int thing_region(World *map, int index) {
+    ThingStore *store = &map->store;
+
+    float x = store->x[index];
+    float z = store->z[index];
+    float step = (float)store->step[index];
+    float next_x = x + store->dx[index] * step;
+    float next_z = z + store->dz[index] * step;
+    float push = 2.0f * (store->box[index] + map->thing_box_max);
+    float box = store->box[index] + map->thing_box_max + push + (fabsf(store->dx[index]) + fabsf(store->dz[index])) * step;
+
+    int c_min = ((int)(fminf(x, next_x) - box) >> WORLD_CELL_SHIFT) - 1;
+    int c_max = ((int)(fmaxf(x, next_x) + box) >> WORLD_CELL_SHIFT) + 1;
+    int r_min = ((int)(fminf(z, next_z) - box) >> WORLD_CELL_SHIFT) - 1;
+    int r_max = ((int)(fmaxf(z, next_z) + box) >> WORLD_CELL_SHIFT) + 1;
+
+    if (c_min < 0 or r_min < 0 or c_max >= map->columns or r_max >= map->rows)
+        return map->region_count;
+
+    int column = c_min >> WORLD_REGION_SHIFT;
+    int row = r_min >> WORLD_REGION_SHIFT;
+
+    if (column != c_max >> WORLD_REGION_SHIFT or row != r_max >> WORLD_REGION_SHIFT)
+        return map->region_count;
+
+    return column + row * map->region_columns;
+}
+
+static void things_move_region(void *context, int job, int worker) {
+    (void)worker;
+    World *map = context;
+    int *items = map->region_items;
+    for (int i = map->region_offsets[job]; i < map->region_offsets[job + 1]; i++) {
+        thing_standard_update(map->things[items[i]]);
+    }
+}
+
+void things_move(World *map, int *ranges, int range_count) {
+    ThingStore *store = &map->store;
+
+    int total = 0;
+    for (int r = 0; r < range_count; r++) {
+        total += ranges[r * 2 + 1] - ranges[r * 2];
+    }
+
+    if (total > map->region_item_cap) {
+        map->region_item_cap = total;
+        map->region_items = safe_realloc(map->region_items, map->region_item_cap * sizeof(int));
+    }
+
+    int regions = map->region_count;
+    int *offsets = map->region_offsets;
+    int *items = map->region_items;
+
+    memset(offsets, 0, (regions + 2) * sizeof(int));
+
+    for (int r = 0; r < range_count; r++) {
+        for (int i = ranges[r * 2]; i < ranges[r * 2 + 1]; i++) {
+            if (store->step[i] != 0 and (FLOAT_NOT_ZERO(store->dx[i]) or FLOAT_NOT_ZERO(store->dz[i]))) {
+                offsets[thing_region(map, i) + 1]++;
             }
         }
+    }
 
-        thing_add_to_cells(this);
+    for (int r = 0; r <= regions; r++) {
+        offsets[r + 1] += offsets[r];
     }
 
-    if (this->ground == false or FLOAT_NOT_ZERO(this->dy)) {
+    for (int r = 0; r < range_count; r++) {
+        for (int i = ranges[r * 2]; i < ranges[r * 2 + 1]; i++) {
+            if (store->step[i] != 0 and (FLOAT_NOT_ZERO(store->dx[i]) or FLOAT_NOT_ZERO(store->dz[i]))) {
+                items[offsets[thing_region(map, i)]++] = i;
+            }
+        }
+    }
 
-        this->dy -= gravity;
-        this->y += this->dy;
+    for (int r = regions; r > 0; r--) {
+        offsets[r] = offsets[r - 1];
+    }
+    offsets[0] = 0;
 
-        if (this->y < this->sec->floor) {
-            this->ground = true;
-            this->dy = 0;
-            this->y = this->sec->floor;
-        } else {
-            this->ground = false;
-        }
+    worker_pool_run(map->workers, things_move_region, map, regions);
+
+    for (int i = offsets[regions]; i < offsets[regions + 1]; i++) {
+        thing_standard_update(map->things[items[i]]);
     }
 }
 
-void thing_initialize(Thing *this, World *map, float x, float z, float r, float box, float height) {
+void thing_initialize(Thing *this, World *map, enum ThingType type, float x, float z, float r, float box, float height) {
 
-    this->id = thing_unique_id++;
+    this->id = map->thing_next_id++;
+    this->type = type;
     this->map = map;
     this->sec = world_find_sector(map, x, z);
 
-    this->x = x;
-    this->y = this->sec->floor;
-    this->z = z;
     this->rotation = r;
     this->rotation_target = r;
-    this->ground = true;
-
-    this->box = box;
-    this->height = height;
 
-    thing_add_to_cells(this);
+    if (box > map->thing_box_max) {
+        map->thing_box_max = box;
+    }
 
     world_add_thing(map, this);
+
+    ThingStore *store = &map->store;
+    int i = this->index;
+
+    store->x[i] = x;
+    store->y[i] = sector_floor_at(this->sec, x, z);
+    store->z[i] = z;
+    store->dx[i] = 0.0f;
+    store->dy[i] = 0.0f;
+    store->dz[i] = 0.0f;
+    store->previous_x[i] = x;
+    store->previous_z[i] = z;
+    store->box[i] = box;
+    store->height[i] = height;
+    store->floor[i] = store->y[i];
+    store->ground[i] = 1;
+    store->phase[i] = (u8)(this->id & (THING_LOD_MAX_STEP - 1));
+    store->step[i] = 1;
+
+    thing_update_plane(this);
+    thing_add_to_cell(this);
 }
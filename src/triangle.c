@@ -7,6 +7,9 @@
 Triangle *new_triangle(float height, int texture, Vec va, Vec vb, Vec vc, bool floor, float scale) {
     Triangle *td = safe_malloc(sizeof(Triangle));
     td->height = height;
+    td->h1 = height;
+    td->h2 = height;
+    td->h3 = height;
     td->texture = texture;
     td->va = va;
     td->vb = vb;
@@ -17,6 +20,21 @@ Triangle *new_triangle(float height, int texture, Vec va, Vec vb, Vec vc, bool f
     td->v2 = vb.y * scale;
     td->u3 = vc.x * scale;
     td->v3 = vc.y * scale;
+    td->s1 = 0.0f;
+    td->t1 = 0.0f;
+    td->s2 = 0.0f;
+    td->t2 = 0.0f;
+    td->s3 = 0.0f;
+    td->t3 = 0.0f;
     td->normal = floor ? 1.0f : -1.0f;
     return td;
 }
+
+void triangle_lightmap_uv(Triangle *this, float x, float z, float width, float height) {
+    this->s1 = (this->va.x - x) / width;
+    this->t1 = (this->va.y - z) / height;
+    this->s2 = (this->vb.x - x) / width;
+    this->t2 = (this->vb.y - z) / height;
+    this->s3 = (this->vc.x - x) / width;
+    this->t3 = (this->vc.y - z) / height;
+}
@@ -14,6 +14,9 @@ typedef struct Triangle Triangle;
 
 struct Triangle {
     float height;
+    float h1;
+    float h2;
+    float h3;
     int texture;
     Vec va;
     Vec vb;
@@ -24,9 +27,16 @@ struct Triangle {
     float v2;
     float u3;
     float v3;
+    float s1;
+    float t1;
+    float s2;
+    float t2;
+    float s3;
+    float t3;
     float normal;
 };
 
 Triangle *new_triangle(float height, int texture, Vec va, Vec vb, Vec vc, bool floor, float scale);
+void triangle_lightmap_uv(Triangle *this, float x, float z, float width, float height);
 
 #endif
@@ -0,0 +1,310 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "world.h"
+
+static int trigger_cell(float value, int count) {
+    int cell = (int)floorf(value) >> WORLD_CELL_SHIFT;
+    return cell < 0 ? 0 : (cell >= count ? count - 1 : cell);
+}
+
+static int trigger_slot(World *this) {
+    for (int i = 0; i < this->trigger_count; i++) {
+        if (this->triggers[i].callback == NULL) {
+            return i;
+        }
+    }
+    if (this->trigger_count == this->trigger_cap) {
+        this->trigger_cap = this->trigger_cap == 0 ? 8 : this->trigger_cap * 2;
+        this->triggers = safe_realloc(this->triggers, this->trigger_cap * sizeof(Trigger));
+    }
+    return this->trigger_count++;
+}
+
+static void trigger_bind(World *this, int id) {
+    Trigger *trigger = &this->triggers[id];
+    if (this->cell_count == 0) {
+        trigger->c_min = 0;
+        trigger->c_max = -1;
+        trigger->r_min = 0;
+        trigger->r_max = -1;
+        return;
+    }
+    trigger->c_min = trigger_cell(trigger->left, this->columns);
+    trigger->c_max = trigger_cell(trigger->right, this->columns);
+    trigger->r_min = trigger_cell(trigger->bottom, this->rows);
+    trigger->r_max = trigger_cell(trigger->top, this->rows);
+    for (int r = trigger->r_min; r <= trigger->r_max; r++)
+        for (int c = trigger->c_min; c <= trigger->c_max; c++)
+            cell_add_trigger(&this->cells[c + r * this->columns], id);
+}
+
+static int trigger_add(World *this, Trigger *trigger) {
+    int id = trigger_slot(this);
+    this->triggers[id] = *trigger;
+    trigger_bind(this, id);
+    return id;
+}
+
+void world_bind_triggers(World *this) {
+    for (int i = 0; i < this->trigger_count; i++) {
+        if (this->triggers[i].callback != NULL) {
+            trigger_bind(this, i);
+        }
+    }
+}
+
+int world_add_area_trigger(World *this, float left, float bottom, float right, float top, TriggerCallback callback, void *context) {
+    Trigger trigger = {0};
+    trigger.type = TRIGGER_AREA;
+    trigger.left = left;
+    trigger.bottom = bottom;
+    trigger.right = right;
+    trigger.top = top;
+    trigger.callback = callback;
+    trigger.context = context;
+    return trigger_add(this, &trigger);
+}
+
+int world_add_line_trigger(World *this, float ax, float az, float bx, float bz, TriggerCallback callback, void *context) {
+    Trigger trigger = {0};
+    trigger.type = TRIGGER_LINE;
+    trigger.left = fminf(ax, bx);
+    trigger.bottom = fminf(az, bz);
+    trigger.right = fmaxf(ax, bx);
+    trigger.top = fmaxf(az, bz);
+    trigger.ax = ax;
+    trigger.az = az;
+    trigger.bx = bx;
+    trigger.bz = bz;
+    trigger.callback = callback;
+    trigger.context = context;
+    return trigger_add(this, &trigger);
+}
+
+void world_remove_trigger(World *this, int id) {
+    Trigger *trigger = &this->triggers[id];
+    for (int r = trigger->r_min; r <= trigger->r_max; r++)
+        for (int c = trigger->c_min; c <= trigger->c_max; c++)
+            cell_remove_trigger(&this->cells[c + r * this->columns], id);
+    if (trigger->release != NULL) {
+        trigger->release(trigger->context);
+    }
+    trigger->callback = NULL;
+    trigger->release = NULL;
+    trigger->context = NULL;
+    trigger->c_min = 0;
+    trigger->c_max = -1;
+    trigger->r_min = 0;
+    trigger->r_max = -1;
+}
+
+static bool trigger_contains(Trigger *this, float x, float z) {
+    return x >= this->left and x < this->right and z >= this->bottom and z < this->top;
+}
+
+static bool trigger_crossed(Trigger *this, float from_x, float from_z, float to_x, float to_z) {
+    float ax = this->ax;
+    float az = this->az;
+    float bx = this->bx;
+    float bz = this->bz;
+    float d1 = (to_x - from_x) * (az - from_z) - (to_z - from_z) * (ax - from_x);
+    float d2 = (to_x - from_x) * (bz - from_z) - (to_z - from_z) * (bx - from_x);
+    if ((d1 > 0.0f) == (d2 > 0.0f))
+        return false;
+    float d3 = (bx - ax) * (from_z - az) - (bz - az) * (from_x - ax);
+    float d4 = (bx - ax) * (to_z - az) - (bz - az) * (to_x - ax);
+    return (d3 > 0.0f) != (d4 > 0.0f);
+}
+
+static void trigger_emit(World *this, int trigger, enum TriggerEventType type, Thing *thing) {
+    worker_lock(this->trigger_lock);
+    if (this->trigger_event_count == this->trigger_event_cap) {
+        this->trigger_event_cap = this->trigger_event_cap == 0 ? 32 : this->trigger_event_cap * 2;
+        this->trigger_events = safe_realloc(this->trigger_events, this->trigger_event_cap * sizeof(TriggerEvent));
+    }
+    TriggerEvent *event = &this->trigger_events[this->trigger_event_count++];
+    event->trigger = trigger;
+    event->type = type;
+    event->thing_id = thing->id;
+    event->thing_index = thing->index;
+    event->thing = NULL;
+    worker_unlock(this->trigger_lock);
+}
+
+void thing_update_triggers(Thing *this) {
+    World *map = this->map;
+    if (map->trigger_count == 0) {
+        return;
+    }
+
+    ThingStore *store = &map->store;
+    int i = this->index;
+
+    float previous_x = store->previous_x[i];
+    float previous_z = store->previous_z[i];
+    float x = store->x[i];
+    float z = store->z[i];
+
+    int c_min = trigger_cell(fminf(previous_x, x), map->columns);
+    int c_max = trigger_cell(fmaxf(previous_x, x), map->columns);
+    int r_min = trigger_cell(fminf(previous_z, z), map->rows);
+    int r_max = trigger_cell(fmaxf(previous_z, z), map->rows);
+
+    for (int r = r_min; r <= r_max; r++) {
+        for (int c = c_min; c <= c_max; c++) {
+            Cell *cell = &map->cells[c + r * map->columns];
+            for (int k = 0; k < cell->trigger_count; k++) {
+                int id = cell->triggers[k];
+                Trigger *trigger = &map->triggers[id];
+                if (c != (trigger->c_min > c_min ? trigger->c_min : c_min) or r != (trigger->r_min > r_min ? trigger->r_min : r_min))
+                    continue;
+                if (trigger->type == TRIGGER_LINE) {
+                    if (trigger_crossed(trigger, previous_x, previous_z, x, z))
+                        trigger_emit(map, id, TRIGGER_CROSS, this);
+                    continue;
+                }
+                bool was_inside = trigger_contains(trigger, previous_x, previous_z);
+                bool inside = trigger_contains(trigger, x, z);
+                if (was_inside != inside)
+                    trigger_emit(map, id, inside ? TRIGGER_ENTER : TRIGGER_EXIT, this);
+            }
+        }
+    }
+}
+
+static int trigger_event_compare(const void *a, const void *b) {
+    const TriggerEvent *x = a;
+    const TriggerEvent *y = b;
+    if (x->trigger != y->trigger)
+        return x->trigger < y->trigger ? -1 : 1;
+    if (x->thing_id != y->thing_id)
+        return x->thing_id < y->thing_id ? -1 : 1;
+    return (int)x->type - (int)y->type;
+}
+
+static Thing *trigger_resolve(World *this, TriggerEvent *event) {
+    int index = event->thing_index;
+    if (index < this->thing_count and this->things[index]->id == event->thing_id) {
+        return this->things[index];
+    }
+    for (int i = 0; i < this->thing_count; i++) {
+        if (this->things[i]->id == event->thing_id) {
+            return this->things[i];
+        }
+    }
+    return NULL;
+}
+
+void world_dispatch_triggers(World *this) {
+    int count = this->trigger_event_count;
+    if (count == 0) {
+        return;
+    }
+
+    TriggerEvent *events = this->trigger_events;
+    qsort(events, count, sizeof(TriggerEvent), trigger_event_compare);
+
+    int begin = 0;
+    while (begin < count) {
+        int id = events[begin].trigger;
+        int end = begin + 1;
+        while (end < count and events[end].trigger == id) {
+            end++;
+        }
+        Trigger *trigger = &this->triggers[id];
+        if (trigger->callback != NULL) {
+            int live = begin;
+            for (int i = begin; i < end; i++) {
+                Thing *thing = trigger_resolve(this, &events[i]);
+                if (thing != NULL) {
+                    events[live] = events[i];
+                    events[live].thing = thing;
+                    live++;
+                }
+            }
+            if (live > begin) {
+                trigger->callback(trigger->context, &events[begin], live - begin);
+            }
+        }
+        begin = end;
+    }
+
+    this->trigger_event_count = 0;
+}
+
+typedef struct TriggerScript TriggerScript;
+
+struct TriggerScript {
+    Hymn *vm;
+    String *handler;
+};
+
+static void trigger_script_callback(void *context, TriggerEvent *events, int count) {
+    TriggerScript *script = context;
+    for (int i = 0; i < count; i++) {
+        hymn_push_i32(script->vm, events[i].trigger);
+        hymn_push_i32(script->vm, (i32)events[i].type);
+        hymn_push_i32(script->vm, (i32)events[i].thing_id);
+        char *error = hymn_call(script->vm, script->handler);
+        if (error != NULL) {
+            fprintf(stderr, "Hymn trigger error: %s\n", error);
+        }
+    }
+}
+
+static void trigger_script_release(void *context) {
+    TriggerScript *script = context;
+    string_delete(script->handler);
+    free(script);
+}
+
+static void *new_trigger_script(Hymn *vm, String *handler) {
+    TriggerScript *script = safe_malloc(sizeof(TriggerScript));
+    script->vm = vm;
+    script->handler = string_copy(handler);
+    return script;
+}
+
+char *world_area_trigger_vm(Hymn *vm) {
+    World *world = hymn_pointer(vm, 0);
+    f32 left = hymn_f32(vm, 1);
+    f32 bottom = hymn_f32(vm, 2);
+    f32 right = hymn_f32(vm, 3);
+    f32 top = hymn_f32(vm, 4);
+    String *handler = hymn_string(vm, 5);
+    if (world == NULL or handler == NULL) {
+        return "area_trigger: expected world, left, bottom, right, top, handler";
+    }
+    int id = world_add_area_trigger(world, left, bottom, right, top, trigger_script_callback, new_trigger_script(vm, handler));
+    world->triggers[id].release = trigger_script_release;
+    hymn_push_i32(vm, id);
+    return NULL;
+}
+
+char *world_line_trigger_vm(Hymn *vm) {
+    World *world = hymn_pointer(vm, 0);
+    f32 ax = hymn_f32(vm, 1);
+    f32 az = hymn_f32(vm, 2);
+    f32 bx = hymn_f32(vm, 3);
+    f32 bz = hymn_f32(vm, 4);
+    String *handler = hymn_string(vm, 5);
+    if (world == NULL or handler == NULL) {
+        return "line_trigger: expected world, ax, az, bx, bz, handler";
+    }
+    int id = world_add_line_trigger(world, ax, az, bx, bz, trigger_script_callback, new_trigger_script(vm, handler));
+    world->triggers[id].release = trigger_script_release;
+    hymn_push_i32(vm, id);
+    return NULL;
+}
+
+char *world_remove_trigger_vm(Hymn *vm) {
+    World *world = hymn_pointer(vm, 0);
+    i32 id = hymn_i32(vm, 1);
+    if (world == NULL or id < 0 or id >= world->trigger_count or world->triggers[id].callback == NULL) {
+        return "remove_trigger: expected world, trigger";
+    }
+    world_remove_trigger(world, id);
+    return NULL;
+}
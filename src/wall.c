@@ -12,9 +12,11 @@ Wall *new_wall(Vec *a, Vec *b, int texture) {
     return w;
 }
 
-void wall_set(Wall *this, float floor, float ceiling, float u, float v, float s, float t) {
+void wall_set(Wall *this, float floor, float ceiling, float floor_b, float ceiling_b, float u, float v, float s, float t) {
     this->floor = floor;
     this->ceiling = ceiling;
+    this->floor_b = floor_b;
+    this->ceiling_b = ceiling_b;
     this->u = u;
     this->v = v;
     this->s = s;
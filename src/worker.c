@@ -0,0 +1,196 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <SDL.h>
+
+#include "worker.h"
+
+typedef struct WorkerStart WorkerStart;
+
+struct WorkerPool {
+    SDL_Thread **threads;
+    int thread_count;
+    SDL_mutex *lock;
+    SDL_cond *start;
+    SDL_cond *done;
+    WorkerTask task;
+    void *context;
+    int jobs;
+    SDL_atomic_t next;
+    int running;
+    unsigned int generation;
+    bool quit;
+};
+
+struct WorkerLock {
+    SDL_mutex *mutex;
+};
+
+struct WorkerCounter {
+    SDL_atomic_t value;
+};
+
+struct WorkerStart {
+    WorkerPool *pool;
+    int index;
+};
+
+static void drain(WorkerPool *this, int worker) {
+    WorkerTask task = this->task;
+    void *context = this->context;
+    int jobs = this->jobs;
+    while (true) {
+        int job = SDL_AtomicAdd(&this->next, 1);
+        if (job >= jobs) {
+            return;
+        }
+        task(context, job, worker);
+    }
+}
+
+static int SDLCALL worker_loop(void *argument) {
+    WorkerStart *start = argument;
+    WorkerPool *this = start->pool;
+    int worker = start->index;
+    free(start);
+
+    unsigned int seen = 0;
+
+    SDL_LockMutex(this->lock);
+    while (true) {
+        while (this->generation == seen and !this->quit) {
+            SDL_CondWait(this->start, this->lock);
+        }
+        if (this->quit) {
+            break;
+        }
+        seen = this->generation;
+        SDL_UnlockMutex(this->lock);
+
+        drain(this, worker);
+
+        SDL_LockMutex(this->lock);
+        this->running--;
+        if (this->running == 0) {
+            SDL_CondSignal(this->done);
+        }
+    }
+    SDL_UnlockMutex(this->lock);
+    return 0;
+}
+
+WorkerPool *new_worker_pool(int thread_count) {
+    WorkerPool *this = safe_calloc(1, sizeof(WorkerPool));
+    this->lock = SDL_CreateMutex();
+    this->start = SDL_CreateCond();
+    this->done = SDL_CreateCond();
+    SDL_AtomicSet(&this->next, 0);
+
+    if (thread_count > 0) {
+        this->threads = safe_calloc(thread_count, sizeof(SDL_Thread *));
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        WorkerStart *start = safe_malloc(sizeof(WorkerStart));
+        start->pool = this;
+        start->index = i + 1;
+        this->threads[i] = SDL_CreateThread(worker_loop, "worker", start);
+        if (this->threads[i] == NULL) {
+            free(start);
+            break;
+        }
+        this->thread_count++;
+    }
+
+    return this;
+}
+
+int worker_pool_size(WorkerPool *this) {
+    return (this == NULL) ? 1 : this->thread_count + 1;
+}
+
+void worker_pool_run(WorkerPool *this, WorkerTask task, void *context, int jobs) {
+    if (this == NULL or this->thread_count == 0 or jobs < 2) {
+        for (int i = 0; i < jobs; i++) {
+            task(context, i, 0);
+        }
+        return;
+    }
+
+    SDL_LockMutex(this->lock);
+    this->task = task;
+    this->context = context;
+    this->jobs = jobs;
+    SDL_AtomicSet(&this->next, 0);
+    this->running = this->thread_count;
+    this->generation++;
+    SDL_CondBroadcast(this->start);
+    SDL_UnlockMutex(this->lock);
+
+    drain(this, 0);
+
+    SDL_LockMutex(this->lock);
+    while (this->running > 0) {
+        SDL_CondWait(this->done, this->lock);
+    }
+    SDL_UnlockMutex(this->lock);
+}
+
+void worker_pool_delete(WorkerPool *this) {
+    SDL_LockMutex(this->lock);
+    this->quit = true;
+    SDL_CondBroadcast(this->start);
+    SDL_UnlockMutex(this->lock);
+
+    for (int i = 0; i < this->thread_count; i++) {
+        SDL_WaitThread(this->threads[i], NULL);
+    }
+
+    SDL_DestroyCond(this->start);
+    SDL_DestroyCond(this->done);
+    SDL_DestroyMutex(this->lock);
+    free(this->threads);
+    free(this);
+}
+
+WorkerLock *new_worker_lock() {
+    WorkerLock *this = safe_malloc(sizeof(WorkerLock));
+    this->mutex = SDL_CreateMutex();
+    return this;
+}
+
+void worker_lock(WorkerLock *this) {
+    SDL_LockMutex(this->mutex);
+}
+
+void worker_unlock(WorkerLock *this) {
+    SDL_UnlockMutex(this->mutex);
+}
+
+void worker_lock_delete(WorkerLock *this) {
+    SDL_DestroyMutex(this->mutex);
+    free(this);
+}
+
+WorkerCounter *new_worker_counter() {
+    WorkerCounter *this = safe_malloc(sizeof(WorkerCounter));
+    SDL_AtomicSet(&this->value, 0);
+    return this;
+}
+
+void worker_counter_set(WorkerCounter *this, int value) {
+    SDL_AtomicSet(&this->value, value);
+}
+
+void worker_counter_add(WorkerCounter *this, int value) {
+    SDL_AtomicAdd(&this->value, value);
+}
+
+int worker_counter_get(WorkerCounter *this) {
+    return SDL_AtomicGet(&this->value);
+}
+
+void worker_counter_delete(WorkerCounter *this) {
+    free(this);
+}
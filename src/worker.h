@@ -0,0 +1,35 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <stdbool.h>
+
+#include "mem.h"
+#include "pie.h"
+
+typedef struct WorkerPool WorkerPool;
+typedef struct WorkerLock WorkerLock;
+typedef struct WorkerCounter WorkerCounter;
+
+typedef void (*WorkerTask)(void *context, int job, int worker);
+
+WorkerPool *new_worker_pool(int thread_count);
+int worker_pool_size(WorkerPool *this);
+void worker_pool_run(WorkerPool *this, WorkerTask task, void *context, int jobs);
+void worker_pool_delete(WorkerPool *this);
+
+WorkerLock *new_worker_lock();
+void worker_lock(WorkerLock *this);
+void worker_unlock(WorkerLock *this);
+void worker_lock_delete(WorkerLock *this);
+
+WorkerCounter *new_worker_counter();
+void worker_counter_set(WorkerCounter *this, int value);
+void worker_counter_add(WorkerCounter *this, int value);
+int worker_counter_get(WorkerCounter *this);
+void worker_counter_delete(WorkerCounter *this);
+
+#endif
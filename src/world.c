@@ -2,33 +2,281 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 
+#include "navmesh.h"
 #include "world.h"
 
 World *new_world() {
-    return safe_calloc(1, sizeof(World));
+    light_falloff_init();
+    things_lod_init();
+    World *this = safe_calloc(1, sizeof(World));
+    particle_pool_init(&this->particles);
+    this->trigger_lock = new_worker_lock();
+    this->thing_tests = new_worker_counter();
+    this->line_tests = new_worker_counter();
+    this->focus_cell = -1;
+    this->lod_cells[0] = 4;
+    this->lod_cells[1] = 8;
+    this->lod_cells[2] = 16;
+    return this;
 }
 
 void world_clear(World *this) {
     (void *)this;
 }
 
-void world_add_thing(World *this, Thing *t) {
+static void wall_lightmap_delete(Wall *wall) {
+    if (wall != NULL and wall->lightmap != NULL) {
+        lightmap_delete(wall->lightmap);
+        wall->lightmap = NULL;
+    }
+}
+
+void world_delete(World *this) {
+    for (int i = 0; i < this->sector_count; i++) {
+        Sector *s = this->sectors[i];
+        if (s->floor_lightmap != NULL) {
+            lightmap_delete(s->floor_lightmap);
+            s->floor_lightmap = NULL;
+        }
+        if (s->ceiling_lightmap != NULL) {
+            lightmap_delete(s->ceiling_lightmap);
+            s->ceiling_lightmap = NULL;
+        }
+    }
+
+    for (int i = 0; i < this->line_count; i++) {
+        Line *ld = this->lines[i];
+        wall_lightmap_delete(ld->bottom);
+        wall_lightmap_delete(ld->middle);
+        wall_lightmap_delete(ld->top);
+    }
+
+    for (int i = 0; i < this->cell_count; i++) {
+        Cell *c = &this->cells[i];
+        free(c->lines);
+        free(c->sectors);
+        free(c->decals);
+        free(c->lights);
+        free(c->triggers);
+    }
+
+    if (this->navmesh != NULL) {
+        navmesh_delete(this->navmesh);
+    }
+
+    ThingStore *store = &this->store;
+    free(store->x);
+    free(store->y);
+    free(store->z);
+    free(store->dx);
+    free(store->dy);
+    free(store->dz);
+    free(store->previous_x);
+    free(store->previous_z);
+    free(store->box);
+    free(store->height);
+    free(store->floor);
+    free(store->plane_x);
+    free(store->plane_z);
+    free(store->plane_d);
+    free(store->ground);
+    free(store->cell);
+    free(store->next);
+    free(store->previous);
+    free(store->rest);
+    free(store->touched);
+    free(store->step);
+    free(store->phase);
+
+    ParticlePool *particles = &this->particles;
+    free(particles->x);
+    free(particles->y);
+    free(particles->z);
+    free(particles->dx);
+    free(particles->dy);
+    free(particles->dz);
+    free(particles->floor);
+    free(particles->ceiling);
+    free(particles->life);
+    free(particles->texture);
+    free(particles->dead);
+
+    for (int i = 0; i < this->trigger_count; i++) {
+        Trigger *trigger = &this->triggers[i];
+        if (trigger->release != NULL) {
+            trigger->release(trigger->context);
+        }
+    }
+
+    worker_lock_delete(this->trigger_lock);
+    worker_counter_delete(this->thing_tests);
+    worker_counter_delete(this->line_tests);
+
+    free(this->lines);
+    free(this->things);
+    free(this->sweep_axis);
+    free(this->sweep_pairs);
+    free(this->sweep_offsets);
+    free(this->sweep_partners);
+    free(this->cell_lod);
+    free(this->thing_sprites);
+    free(this->thing_models);
+    free(this->decals);
+    free(this->sectors);
+    free(this->movers);
+    free(this->riders);
+    free(this->rebake);
+    free(this->lights);
+    free(this->triggers);
+    free(this->trigger_events);
+    free(this->cells);
+    free(this->region_offsets);
+    free(this->region_items);
+    free(this);
+}
+
+typedef void (*ThingKernel)(World *map, int *ranges, int range_count);
+
+static const ThingKernel thing_kernels[THING_TYPE_COUNT] = {
+    [THING_TYPE_HERO] = things_move,
+    [THING_TYPE_BARON] = things_move,
+    [THING_TYPE_SCENERY] = NULL,
+};
 
-    if (this->thing_cap == 0) {
-        this->things = safe_malloc(sizeof(Thing *));
-        this->things[0] = t;
-        this->thing_cap = 1;
-        this->thing_count = 1;
+static const bool thing_sleeps[THING_TYPE_COUNT] = {
+    [THING_TYPE_HERO] = false,
+    [THING_TYPE_BARON] = true,
+    [THING_TYPE_SCENERY] = false,
+};
+
+void thing_store_reserve(World *this, int count) {
+    if (count <= this->thing_cap) {
+        return;
+    }
+    int cap = this->thing_cap == 0 ? 8 : this->thing_cap * 2;
+    while (cap < count) {
+        cap *= 2;
+    }
+    ThingStore *store = &this->store;
+    usize size = cap * sizeof(float);
+    this->things = safe_realloc(this->things, cap * sizeof(Thing *));
+    store->x = safe_realloc(store->x, size);
+    store->y = safe_realloc(store->y, size);
+    store->z = safe_realloc(store->z, size);
+    store->dx = safe_realloc(store->dx, size);
+    store->dy = safe_realloc(store->dy, size);
+    store->dz = safe_realloc(store->dz, size);
+    store->previous_x = safe_realloc(store->previous_x, size);
+    store->previous_z = safe_realloc(store->previous_z, size);
+    store->box = safe_realloc(store->box, size);
+    store->height = safe_realloc(store->height, size);
+    store->floor = safe_realloc(store->floor, size);
+    store->plane_x = safe_realloc(store->plane_x, size);
+    store->plane_z = safe_realloc(store->plane_z, size);
+    store->plane_d = safe_realloc(store->plane_d, size);
+    store->ground = safe_realloc(store->ground, cap * sizeof(u8));
+    store->cell = safe_realloc(store->cell, cap * sizeof(int));
+    store->next = safe_realloc(store->next, cap * sizeof(int));
+    store->previous = safe_realloc(store->previous, cap * sizeof(int));
+    store->rest = safe_realloc(store->rest, cap * sizeof(u8));
+    store->touched = safe_realloc(store->touched, cap * sizeof(Thing *));
+    store->step = safe_realloc(store->step, cap * sizeof(u8));
+    store->phase = safe_realloc(store->phase, cap * sizeof(u8));
+    this->thing_cap = cap;
+}
+
+static void thing_store_move(World *this, int from, int to) {
+    if (from == to) {
+        return;
+    }
+    ThingStore *store = &this->store;
+    store->x[to] = store->x[from];
+    store->y[to] = store->y[from];
+    store->z[to] = store->z[from];
+    store->dx[to] = store->dx[from];
+    store->dy[to] = store->dy[from];
+    store->dz[to] = store->dz[from];
+    store->previous_x[to] = store->previous_x[from];
+    store->previous_z[to] = store->previous_z[from];
+    store->box[to] = store->box[from];
+    store->height[to] = store->height[from];
+    store->floor[to] = store->floor[from];
+    store->plane_x[to] = store->plane_x[from];
+    store->plane_z[to] = store->plane_z[from];
+    store->plane_d[to] = store->plane_d[from];
+    store->ground[to] = store->ground[from];
+    store->rest[to] = store->rest[from];
+    store->touched[to] = store->touched[from];
+    store->step[to] = store->step[from];
+    store->phase[to] = store->phase[from];
+
+    int previous = store->previous[from];
+    int next = store->next[from];
+    if (previous != -1) {
+        store->next[previous] = to;
     } else {
+        this->cells[store->cell[from]].thing_head = to;
+    }
+    if (next != -1) {
+        store->previous[next] = to;
+    }
+    store->cell[to] = store->cell[from];
+    store->next[to] = next;
+    store->previous[to] = previous;
+
+    Thing *t = this->things[from];
+    t->index = to;
+    this->things[to] = t;
+}
 
-        if (this->thing_count == this->thing_cap) {
-            this->thing_cap += 8;
-            this->things = safe_realloc(this->things, this->thing_cap * sizeof(Thing *));
+static int *thing_partition_end(World *this, int partition) {
+    int type = partition >> 1;
+    return (partition & 1) ? &this->thing_type_end[type] : &this->thing_awake_end[type];
+}
+
+static void thing_store_swap(World *this, int a, int b) {
+    if (a == b) {
+        return;
+    }
+    thing_store_reserve(this, this->thing_count + 1);
+    int spare = this->thing_count;
+    thing_store_move(this, a, spare);
+    thing_store_move(this, b, a);
+    thing_store_move(this, spare, b);
+}
+
+void world_add_thing(World *this, Thing *t) {
+
+    thing_store_reserve(this, this->thing_count + 1);
+
+    int partition = (int)t->type << 1;
+    int hole = this->thing_count;
+    for (int p = (THING_TYPE_COUNT << 1) - 1; p > partition; p--) {
+        int begin = *thing_partition_end(this, p - 1);
+        int *end = thing_partition_end(this, p);
+        if (begin < *end) {
+            thing_store_move(this, begin, hole);
+            hole = begin;
         }
-        this->things[this->thing_count] = t;
-        this->thing_count++;
+        (*end)++;
     }
+    (*thing_partition_end(this, partition))++;
 
+    t->index = hole;
+    this->things[hole] = t;
+    this->thing_count++;
+
+    this->store.rest[hole] = 0;
+    this->store.touched[hole] = NULL;
+
+    if (this->sweep_count == this->sweep_cap) {
+        this->sweep_cap = this->sweep_cap == 0 ? 8 : this->sweep_cap * 2;
+        this->sweep_axis = safe_realloc(this->sweep_axis, this->sweep_cap * sizeof(Thing *));
+    }
+    t->sweep_slot = this->sweep_count;
+    this->sweep_axis[this->sweep_count++] = t;
+
+    t->sprite_slot = this->thing_sprites_count;
     if (this->thing_sprites_cap == 0) {
         this->thing_sprites = safe_malloc(sizeof(Thing *));
         this->thing_sprites[0] = t;
@@ -38,66 +286,104 @@ void world_add_thing(World *this, Thing *t) {
 
         if (this->thing_sprites_count == this->thing_sprites_cap) {
             this->thing_sprites_cap += 8;
-            this->thing_sprites = safe_realloc(this->things, this->thing_sprites_cap * sizeof(Thing *));
+            this->thing_sprites = safe_realloc(this->thing_sprites, this->thing_sprites_cap * sizeof(Thing *));
         }
         this->thing_sprites[this->thing_sprites_count] = t;
         this->thing_sprites_count++;
     }
 }
 
-void world_remove_thing(World *this, Thing *t) {
+void world_wake_thing(World *this, Thing *t) {
+    ThingStore *store = &this->store;
+    store->rest[t->index] = 0;
+    int awake = this->thing_awake_end[t->type];
+    if (t->index >= awake) {
+        thing_store_swap(this, t->index, awake);
+        this->thing_awake_end[t->type]++;
+    }
+}
 
-    int len = this->thing_count;
-    Thing **things = this->things;
-    for (int i = 0; i < len; i++) {
-        if (things[i] == t) {
-            things[i] = things[len - 1];
-            this->thing_count--;
-            break;
+static void world_sleep_thing(World *this, Thing *t) {
+    int awake = --this->thing_awake_end[t->type];
+    thing_store_swap(this, t->index, awake);
+    this->store.touched[awake] = NULL;
+}
+
+static void world_schedule_things(World *this) {
+    ThingStore *store = &this->store;
+
+    int begin = 0;
+    for (int type = 0; type < THING_TYPE_COUNT; type++) {
+        int awake = this->thing_awake_end[type];
+        // Movers set touched during the kernel pass, so every entry is consumed here within the same tick.
+        for (int i = begin; i < awake; i++) {
+            Thing *touched = store->touched[i];
+            if (touched != NULL) {
+                store->touched[i] = NULL;
+                world_wake_thing(this, touched);
+            }
         }
+        begin = this->thing_type_end[type];
     }
 
-    len = this->thing_sprites_count;
-    things = this->thing_sprites;
-    for (int i = 0; i < len; i++) {
-        if (things[i] == t) {
-            things[i] = things[len - 1];
-            this->thing_sprites_count--;
-            break;
+    Thing *nearby[THING_WAKE_BUFFER];
+    int heroes = this->thing_type_end[THING_TYPE_HERO];
+    for (int h = 0; h < heroes; h++) {
+        int count = world_query_radius(this, store->x[h], store->z[h], THING_WAKE_RADIUS, nearby, THING_WAKE_BUFFER);
+        if (count > THING_WAKE_BUFFER) {
+            count = THING_WAKE_BUFFER;
+        }
+        for (int i = 0; i < count; i++) {
+            if (nearby[i]->index >= this->thing_awake_end[nearby[i]->type]) {
+                world_wake_thing(this, nearby[i]);
+            }
         }
     }
+
+    begin = 0;
+    for (int type = 0; type < THING_TYPE_COUNT; type++) {
+        if (thing_sleeps[type]) {
+            for (int i = this->thing_awake_end[type] - 1; i >= begin; i--) {
+                bool rest = store->ground[i] and FLOAT_ZERO(store->dx[i]) and FLOAT_ZERO(store->dz[i]) and FLOAT_ZERO(store->dy[i]);
+                store->rest[i] = rest ? store->rest[i] + (store->rest[i] < THING_SLEEP_TICKS) : 0;
+                if (store->rest[i] >= THING_SLEEP_TICKS) {
+                    world_sleep_thing(this, this->things[i]);
+                }
+            }
+        }
+        begin = this->thing_type_end[type];
+    }
 }
 
-void world_add_particle(World *this, Particle *t) {
+void world_remove_thing(World *this, Thing *t) {
 
-    if (this->particle_cap == 0) {
-        this->particles = safe_malloc(sizeof(Particle *));
-        this->particles[0] = t;
-        this->particle_cap = 1;
-        this->particle_count = 1;
-        return;
-    }
+    thing_remove_from_cell(t);
 
-    if (this->particle_count == this->particle_cap) {
-        this->particle_cap += 8;
-        this->particles = safe_realloc(this->particles, this->particle_cap * sizeof(Particle *));
+    if (this->focus == t) {
+        this->focus = NULL;
     }
 
-    this->particles[this->particle_count] = t;
-    this->particle_count++;
-}
-
-void world_remove_particle(World *this, Particle *t) {
+    if (this->navmesh != NULL) {
+        navmesh_forget(this->navmesh, t);
+    }
 
-    int len = this->particle_count;
-    Particle **particles = this->particles;
-    for (int i = 0; i < len; i++) {
-        if (particles[i] == t) {
-            particles[i] = particles[len - 1];
-            this->particle_count--;
-            return;
+    int partition = ((int)t->type << 1) + (t->index >= this->thing_awake_end[t->type]);
+    int hole = t->index;
+    for (int p = partition; p < THING_TYPE_COUNT << 1; p++) {
+        int last = --(*thing_partition_end(this, p));
+        if (last >= hole) {
+            thing_store_move(this, last, hole);
+            hole = last;
         }
     }
+    this->things[hole] = NULL;
+    this->thing_count--;
+
+    this->sweep_axis[t->sweep_slot] = NULL;
+
+    Thing *last = this->thing_sprites[--this->thing_sprites_count];
+    this->thing_sprites[t->sprite_slot] = last;
+    last->sprite_slot = t->sprite_slot;
 }
 
 void world_add_decal(World *this, Decal *t) {
@@ -151,7 +437,68 @@ void world_add_sector(World *this, Sector *s) {
     this->sector_count++;
 }
 
-Sector *world_find_sector(World *this, float x, float y) {
+void world_add_light(World *this, Light *t) {
+
+    if (this->light_cap == 0) {
+        this->lights = safe_malloc(sizeof(Light *));
+        this->lights[0] = t;
+        this->light_cap = 1;
+        this->light_count = 1;
+    } else {
+
+        if (this->light_count == this->light_cap) {
+            this->light_cap += 8;
+            this->lights = safe_realloc(this->lights, this->light_cap * sizeof(Light *));
+        }
+        this->lights[this->light_count] = t;
+        this->light_count++;
+    }
+
+    light_add_to_cells(t);
+}
+
+void world_remove_light(World *this, Light *t) {
+
+    light_remove_from_cells(t);
+
+    int len = this->light_count;
+    Light **lights = this->lights;
+    for (int i = 0; i < len; i++) {
+        if (lights[i] == t) {
+            lights[i] = lights[len - 1];
+            this->light_count--;
+            return;
+        }
+    }
+}
+
+float world_dynamic_light(World *this, float x, float y, float z) {
+    int c = (int)x >> WORLD_CELL_SHIFT;
+    int r = (int)z >> WORLD_CELL_SHIFT;
+
+    if (c < 0 or r < 0 or c >= this->columns or r >= this->rows) {
+        return 0.0f;
+    }
+
+    float light = 0.0f;
+
+    Cell *cell = &this->cells[c + r * this->columns];
+    Light **lights = cell->lights;
+    int count = cell->light_count;
+    for (int i = 0; i < count; i++) {
+        light += light_sample(lights[i], x, y, z);
+    }
+
+    return light;
+}
+
+float world_light(World *this, Sector *s, float x, float y, float z) {
+    float light = (s != NULL) ? s->light : SECTOR_DEFAULT_LIGHT;
+    light += world_dynamic_light(this, x, y, z);
+    return light > 1.0f ? 1.0f : light;
+}
+
+static Sector *world_search_sector(World *this, float x, float y) {
     for (int i = 0; i < this->sector_count; i++) {
         Sector *s = this->sectors[i];
         if (s->outside != NULL)
@@ -162,6 +509,103 @@ Sector *world_find_sector(World *this, float x, float y) {
     return NULL;
 }
 
+Sector *world_find_sector(World *this, float x, float y) {
+    int c = (int)floorf(x) >> WORLD_CELL_SHIFT;
+    int r = (int)floorf(y) >> WORLD_CELL_SHIFT;
+    if (c < 0 or r < 0 or c >= this->columns or r >= this->rows) {
+        return world_search_sector(this, x, y);
+    }
+    Cell *cell = &this->cells[c + r * this->columns];
+    if (cell->sector != NULL) {
+        return cell->sector;
+    }
+    Sector **sectors = cell->sectors;
+    int count = cell->sector_count;
+    for (int i = 0; i < count; i++) {
+        if (sector_contains(sectors[i], x, y)) {
+            return sectors[i];
+        }
+    }
+    return NULL;
+}
+
+static int sector_depth(Sector *s) {
+    int depth = 0;
+    while (s->outside != NULL) {
+        s = s->outside;
+        depth++;
+    }
+    return depth;
+}
+
+static void build_cell_sectors(World *this) {
+    Sector **sectors = this->sectors;
+    int sector_count = this->sector_count;
+
+    Sector **order = safe_malloc(sector_count * sizeof(Sector *));
+    int *depth = safe_malloc(sector_count * sizeof(int));
+
+    for (int i = 0; i < sector_count; i++) {
+        Sector *s = sectors[i];
+        int d = sector_depth(s);
+        int k = i - 1;
+        while (k >= 0 and depth[k] < d) {
+            order[k + 1] = order[k];
+            depth[k + 1] = depth[k];
+            k--;
+        }
+        order[k + 1] = s;
+        depth[k + 1] = d;
+    }
+
+    const float size = (float)(1 << WORLD_CELL_SHIFT);
+
+    for (int i = 0; i < sector_count; i++) {
+        Sector *s = order[i];
+
+        float left = FLT_MAX;
+        float right = -FLT_MAX;
+        float bottom = FLT_MAX;
+        float top = -FLT_MAX;
+
+        for (int v = 0; v < s->vec_count; v++) {
+            Vec *vec = s->vecs[v];
+            left = fminf(left, vec->x);
+            right = fmaxf(right, vec->x);
+            bottom = fminf(bottom, vec->y);
+            top = fmaxf(top, vec->y);
+        }
+
+        int c_min = (int)(left / size);
+        int c_max = (int)(right / size);
+        int r_min = (int)(bottom / size);
+        int r_max = (int)(top / size);
+
+        if (c_min < 0) c_min = 0;
+        if (r_min < 0) r_min = 0;
+        if (c_max >= this->columns) c_max = this->columns - 1;
+        if (r_max >= this->rows) r_max = this->rows - 1;
+
+        for (int r = r_min; r <= r_max; r++) {
+            for (int c = c_min; c <= c_max; c++) {
+                cell_add_sector(&this->cells[c + r * this->columns], s);
+            }
+        }
+    }
+
+    for (int r = 0; r < this->rows; r++) {
+        for (int c = 0; c < this->columns; c++) {
+            Cell *cell = &this->cells[c + r * this->columns];
+            if (cell->line_count == 0) {
+                cell->sector = world_search_sector(this, ((float)c + 0.5f) * size, ((float)r + 0.5f) * size);
+            }
+        }
+    }
+
+    free(order);
+    free(depth);
+}
+
 static void build_cell_lines(World *this, Line *line) {
 
     double dx = fabs(line->b->x - line->a->x);
@@ -217,6 +661,66 @@ static void build_cell_lines(World *this, Line *line) {
     }
 }
 
+static void build_walls(Sector *sec) {
+    float bottom = sec->bottom;
+    float top = sec->top;
+
+    Line **lines = sec->lines;
+    int line_count = sec->line_count;
+
+    float u = 0.0f;
+
+    for (int i = 0; i < line_count; i++) {
+
+        Line *line = lines[i];
+
+        float x = line->a->x - line->b->x;
+        float y = line->a->y - line->b->y;
+        float s = u + sqrtf(x * x + y * y) * WORLD_SCALE;
+
+        float floor = sector_floor_at(sec, line->a->x, line->a->y);
+        float ceil = sector_ceiling_at(sec, line->a->x, line->a->y);
+        float floor_b = sector_floor_at(sec, line->b->x, line->b->y);
+        float ceil_b = sector_ceiling_at(sec, line->b->x, line->b->y);
+
+        if (line->bottom != NULL) {
+            wall_set(line->bottom, bottom, floor, bottom, floor_b, u, bottom * WORLD_SCALE, s, floor * WORLD_SCALE);
+            line->bottom->light = sec->light;
+        }
+
+        if (line->middle != NULL) {
+            wall_set(line->middle, floor, ceil, floor_b, ceil_b, u, floor * WORLD_SCALE, s, ceil * WORLD_SCALE);
+            line->middle->light = sec->light;
+        }
+
+        if (line->top != NULL) {
+            wall_set(line->top, ceil, top, ceil_b, top, u, ceil * WORLD_SCALE, s, top * WORLD_SCALE);
+            line->top->light = sec->light;
+        }
+
+        u = s;
+    }
+}
+
+static void build_flats(Sector *sec) {
+    Triangle **triangles = sec->triangles;
+    int triangle_count = sec->triangle_count;
+    for (int i = 0; i < triangle_count; i++) {
+        Triangle *td = triangles[i];
+        if (td->normal > 0.0f) {
+            td->height = sec->floor;
+            td->h1 = sector_floor_at(sec, td->va.x, td->va.y);
+            td->h2 = sector_floor_at(sec, td->vb.x, td->vb.y);
+            td->h3 = sector_floor_at(sec, td->vc.x, td->vc.y);
+        } else {
+            td->height = sec->ceiling;
+            td->h1 = sector_ceiling_at(sec, td->va.x, td->va.y);
+            td->h2 = sector_ceiling_at(sec, td->vb.x, td->vb.y);
+            td->h3 = sector_ceiling_at(sec, td->vc.x, td->vc.y);
+        }
+    }
+}
+
 static void build_lines(World *this, Sector *sec) {
     int line_count = sec->line_count;
 
@@ -224,11 +728,6 @@ static void build_lines(World *this, Sector *sec) {
         return;
     }
 
-    float bottom = sec->bottom;
-    float floor = sec->floor;
-    float ceil = sec->ceiling;
-    float top = sec->top;
-
     Sector *plus;
     Sector *minus;
 
@@ -242,33 +741,162 @@ static void build_lines(World *this, Sector *sec) {
 
     Line **lines = sec->lines;
 
-    float u = 0.0f;
-
     for (int i = 0; i < line_count; i++) {
-
         Line *line = lines[i];
-
         build_cell_lines(this, line);
-
         line_set_sectors(line, plus, minus);
+    }
 
-        float x = line->a->x - line->b->x;
-        float y = line->a->y - line->b->y;
-        float s = u + sqrtf(x * x + y * y) * WORLD_SCALE;
+    build_walls(sec);
+}
 
-        if (line->bottom != NULL) {
-            wall_set(line->bottom, bottom, floor, u, bottom * WORLD_SCALE, s, floor * WORLD_SCALE);
+static void sector_riders(World *this, SectorMover *mover, float previous) {
+    Sector *sec = mover->sec;
+    ThingStore *store = &this->store;
+    int count = world_query_box(this, mover->left, mover->bottom, mover->right, mover->top, this->riders, this->rider_cap);
+    if (count > this->rider_cap) {
+        while (this->rider_cap < count) {
+            this->rider_cap = this->rider_cap == 0 ? THING_WAKE_BUFFER : this->rider_cap * 2;
+        }
+        this->riders = safe_realloc(this->riders, this->rider_cap * sizeof(Thing *));
+        count = world_query_box(this, mover->left, mover->bottom, mover->right, mover->top, this->riders, this->rider_cap);
+    }
+    Thing **riders = this->riders;
+    for (int i = 0; i < count; i++) {
+        Thing *t = riders[i];
+        if (t->sec != sec) {
+            continue;
         }
+        int k = t->index;
+        thing_update_plane(t);
+        float floor = sector_floor_at(sec, store->x[k], store->z[k]);
+        float was = floor - (sec->floor - previous);
+        store->floor[k] = floor;
+        if (store->ground[k] and FLOAT_EQUAL(store->y[k], was)) {
+            if (floor > was) {
+                store->y[k] = floor;
+            } else {
+                store->ground[k] = 0;
+            }
+        } else if (store->y[k] < floor) {
+            store->y[k] = floor;
+        }
+        if (k >= this->thing_awake_end[t->type]) {
+            world_wake_thing(this, t);
+        }
+    }
+}
 
-        if (line->middle != NULL) {
-            wall_set(line->middle, floor, ceil, u, floor * WORLD_SCALE, s, ceil * WORLD_SCALE);
+static void world_dirty_lightmaps(World *this, Sector *s) {
+    if (s->floor_lightmap == NULL or s->lightmap_dirty) {
+        return;
+    }
+    s->lightmap_dirty = true;
+    if (this->rebake_count == this->rebake_cap) {
+        this->rebake_cap = this->rebake_cap == 0 ? 8 : this->rebake_cap * 2;
+        this->rebake = safe_realloc(this->rebake, this->rebake_cap * sizeof(Sector *));
+    }
+    this->rebake[this->rebake_count++] = s;
+}
+
+void world_set_sector_heights(World *this, Sector *s, float floor, float ceiling) {
+    s->floor = floor;
+    s->ceiling = ceiling;
+    sector_update_planes(s);
+
+    build_walls(s);
+    build_flats(s);
+    world_dirty_lightmaps(this, s);
+
+    if (this->navmesh != NULL) {
+        navmesh_update_sector(this->navmesh, s);
+    }
+}
+
+void world_move_sector(World *this, Sector *s, float floor, float ceiling, float speed) {
+    for (int i = 0; i < this->mover_count; i++) {
+        SectorMover *mover = &this->movers[i];
+        if (mover->sec == s) {
+            mover->floor = floor;
+            mover->ceiling = ceiling;
+            mover->speed = speed;
+            return;
         }
+    }
 
-        if (line->top != NULL) {
-            wall_set(line->top, ceil, top, u, ceil * WORLD_SCALE, s, top * WORLD_SCALE);
+    if (this->mover_count == this->mover_cap) {
+        this->mover_cap += 8;
+        this->movers = safe_realloc(this->movers, this->mover_cap * sizeof(SectorMover));
+    }
+
+    SectorMover *mover = &this->movers[this->mover_count++];
+    mover->sec = s;
+    mover->floor = floor;
+    mover->ceiling = ceiling;
+    mover->speed = speed;
+    mover->left = FLT_MAX;
+    mover->bottom = FLT_MAX;
+    mover->right = -FLT_MAX;
+    mover->top = -FLT_MAX;
+
+    for (int i = 0; i < s->vec_count; i++) {
+        Vec *vec = s->vecs[i];
+        mover->left = fminf(mover->left, vec->x);
+        mover->bottom = fminf(mover->bottom, vec->y);
+        mover->right = fmaxf(mover->right, vec->x);
+        mover->top = fmaxf(mover->top, vec->y);
+    }
+}
+
+void world_set_sector_slope(World *this, Sector *s, float anchor_x, float anchor_z, float floor_x, float floor_z, float ceiling_x, float ceiling_z) {
+    sector_set_slope(s, anchor_x, anchor_z, floor_x, floor_z, ceiling_x, ceiling_z);
+
+    build_walls(s);
+    build_flats(s);
+    world_dirty_lightmaps(this, s);
+
+    if (this->navmesh != NULL) {
+        navmesh_update_sector(this->navmesh, s);
+    }
+
+    ThingStore *store = &this->store;
+    for (int i = 0; i < this->thing_count; i++) {
+        Thing *t = this->things[i];
+        if (t->sec != s) {
+            continue;
+        }
+        thing_update_plane(t);
+        store->floor[i] = sector_floor_at(s, store->x[i], store->z[i]);
+        if (i >= this->thing_awake_end[t->type]) {
+            world_wake_thing(this, t);
         }
+    }
+}
 
-        u = s;
+static float approach(float value, float target, float speed) {
+    if (value < target) {
+        return fminf(value + speed, target);
+    }
+    return fmaxf(value - speed, target);
+}
+
+static void world_update_movers(World *this) {
+    int i = 0;
+    while (i < this->mover_count) {
+        SectorMover *mover = &this->movers[i];
+        Sector *sec = mover->sec;
+        float previous = sec->floor;
+        float floor = approach(sec->floor, mover->floor, mover->speed);
+        float ceiling = approach(sec->ceiling, mover->ceiling, mover->speed);
+
+        world_set_sector_heights(this, sec, floor, ceiling);
+        sector_riders(this, mover, previous);
+
+        if (floor == mover->floor and ceiling == mover->ceiling) {
+            this->movers[i] = this->movers[--this->mover_count];
+        } else {
+            i++;
+        }
     }
 }
 
@@ -305,6 +933,19 @@ void world_build(World *this, Array *lines) {
     this->cell_count = this->rows * this->columns;
     this->cells = safe_calloc(this->cell_count, sizeof(Cell));
 
+    for (int i = 0; i < this->cell_count; i++) {
+        this->cells[i].thing_head = -1;
+    }
+
+    this->cell_lod = safe_calloc(this->cell_count, sizeof(u8));
+
+    const int region = (1 << WORLD_REGION_SHIFT) - 1;
+
+    this->region_columns = (this->columns + region) >> WORLD_REGION_SHIFT;
+    this->region_rows = (this->rows + region) >> WORLD_REGION_SHIFT;
+    this->region_count = this->region_columns * this->region_rows;
+    this->region_offsets = safe_calloc(this->region_count + 2, sizeof(int));
+
     Array *sector_inside_lists = safe_calloc(sector_count, sizeof(Array));
 
     for (int i = 0; i < sector_count; i++) {
@@ -394,32 +1035,138 @@ void world_build(World *this, Array *lines) {
 
     for (int i = 0; i < sector_count; i++) {
         triangulate_sector(sectors[i], WORLD_SCALE);
+        build_flats(sectors[i]);
     }
 
     for (int i = 0; i < sector_count; i++) {
         build_lines(this, sectors[i]);
     }
+
+    build_cell_sectors(this);
+
+    this->navmesh = new_navmesh(this);
+
+    for (int i = 0; i < this->light_count; i++) {
+        light_add_to_cells(this->lights[i]);
+    }
+
+    world_bind_triggers(this);
+
+    world_bake_lightmaps(this);
+}
+
+static void world_update_lod(World *this) {
+    int focus = -1;
+    if (this->focus != NULL) {
+        focus = this->store.cell[this->focus->index];
+    }
+    if (focus == this->focus_cell and memcmp(this->lod_cells, this->lod_cells_built, sizeof(this->lod_cells)) == 0) {
+        return;
+    }
+    this->focus_cell = focus;
+    memcpy(this->lod_cells_built, this->lod_cells, sizeof(this->lod_cells));
+
+    if (focus == -1) {
+        memset(this->cell_lod, 0, this->cell_count * sizeof(u8));
+        return;
+    }
+
+    int focus_c = focus % this->columns;
+    int focus_r = focus / this->columns;
+
+    for (int r = 0; r < this->rows; r++) {
+        for (int c = 0; c < this->columns; c++) {
+            int distance = abs(c - focus_c);
+            if (abs(r - focus_r) > distance) {
+                distance = abs(r - focus_r);
+            }
+            u8 level = 0;
+            while (level < THING_LOD_LEVELS - 1 and distance >= this->lod_cells[level]) {
+                level++;
+            }
+            this->cell_lod[c + r * this->columns] = level;
+        }
+    }
+}
+
+static void particles_update_chunk(void *context, int job, int worker) {
+    (void)worker;
+    ParticlePool *particles = context;
+    int begin = job * PARTICLE_CHUNK;
+    int end = begin + PARTICLE_CHUNK;
+    if (end > particles->count) {
+        end = particles->count;
+    }
+    particles_integrate(particles, begin, end);
 }
 
 void world_update(World *this) {
 
-    int thing_count = this->thing_count;
-    Thing **things = this->things;
-    for (int i = 0; i < thing_count; i++) {
-        Thing *t = things[i];
-        t->update(t);
+    worker_counter_set(this->thing_tests, 0);
+    worker_counter_set(this->line_tests, 0);
+    for (int i = 0; i < this->cell_count; i++) {
+        this->cells[i].tests = 0;
     }
 
-    int particle_count = this->particle_count;
-    Particle **particles = this->particles;
-    for (int i = 0; i < particle_count; i++) {
-        Particle *p = particles[i];
-        if (p->update(p)) {
-            particles[i] = particles[particle_count - 1];
-            particles[particle_count - 1] = NULL;
-            this->particle_count--;
-            particle_count--;
-            i--;
+    world_update_lod(this);
+    world_update_movers(this);
+    world_rebake_lightmaps(this);
+
+    int begin = 0;
+    for (int type = 0; type < THING_TYPE_COUNT; type++) {
+        int awake = this->thing_awake_end[type];
+        if (thing_kernels[type] != NULL and begin < awake) {
+            things_schedule(this, begin, awake);
+            things_friction(&this->store, begin, awake);
         }
+        begin = this->thing_type_end[type];
     }
+
+    things_broadphase(this);
+
+    int ranges[THING_TYPE_COUNT * 2];
+
+    for (int type = 0; type < THING_TYPE_COUNT; type++) {
+        ThingKernel kernel = thing_kernels[type];
+        bool shared = false;
+        for (int k = 0; k < type; k++) {
+            shared |= thing_kernels[k] == kernel;
+        }
+        if (kernel == NULL or shared) {
+            continue;
+        }
+        int range_count = 0;
+        for (int k = type; k < THING_TYPE_COUNT; k++) {
+            int start = k == 0 ? 0 : this->thing_type_end[k - 1];
+            int awake = this->thing_awake_end[k];
+            if (thing_kernels[k] == kernel and start < awake) {
+                ranges[range_count * 2] = start;
+                ranges[range_count * 2 + 1] = awake;
+                range_count++;
+            }
+        }
+        if (range_count > 0) {
+            kernel(this, ranges, range_count);
+        }
+    }
+
+    begin = 0;
+    for (int type = 0; type < THING_TYPE_COUNT; type++) {
+        int awake = this->thing_awake_end[type];
+        if (thing_kernels[type] != NULL and begin < awake) {
+            things_ground(&this->store, begin, awake);
+            things_gravity(&this->store, begin, awake);
+        }
+        begin = this->thing_type_end[type];
+    }
+
+    world_schedule_things(this);
+    world_dispatch_triggers(this);
+
+    this->tick++;
+
+    ParticlePool *particles = &this->particles;
+    int chunks = (particles->count + PARTICLE_CHUNK - 1) / PARTICLE_CHUNK;
+    worker_pool_run(this->workers, particles_update_chunk, particles, chunks);
+    particles_compact(particles);
 }
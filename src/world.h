@@ -9,6 +9,7 @@
 #include <math.h>
 
 #include "array.h"
+#include "hymn.h"
 #include "math_util.h"
 #include "mem.h"
 #include "pie.h"
@@ -16,147 +17,334 @@
 #include "set.h"
 #include "sprite.h"
 #include "triangulate.h"
+#include "worker.h"
 #include "world.h"
 
 #define WORLD_SCALE 0.25f
 #define WORLD_CELL_SHIFT 5
+#define WORLD_REGION_SHIFT 3
+
+#define THING_SLEEP_TICKS 16
+#define THING_REST_SPEED 0.001f
+#define THING_WAKE_RADIUS 128.0f
+#define THING_WAKE_BUFFER 256
+#define THING_STEP_HEIGHT 1.0f
+
+#define THING_LOD_LEVELS 4
+#define THING_LOD_MAX_STEP (1 << (THING_LOD_LEVELS - 1))
+
+#define LIGHT_FALLOFF_STEPS 256
+
+#define PARTICLE_CAPACITY 16384
+#define PARTICLE_CHUNK 2048
 
 extern const float gravity;
 extern const float wind_resistance;
 
-extern unsigned int thing_unique_id;
+extern float light_falloff[LIGHT_FALLOFF_STEPS];
 
 enum ThingType {
     THING_TYPE_HERO,
     THING_TYPE_BARON,
     THING_TYPE_SCENERY,
+    THING_TYPE_COUNT,
 };
 
 typedef struct World World;
+typedef struct ThingStore ThingStore;
 typedef struct Cell Cell;
 typedef struct Thing Thing;
-typedef struct Particle Particle;
+typedef struct ParticlePool ParticlePool;
 typedef struct Decal Decal;
+typedef struct Light Light;
+typedef struct Ray Ray;
+typedef struct RayHit RayHit;
+typedef struct NavMesh NavMesh;
+typedef struct SectorMover SectorMover;
+typedef struct Trigger Trigger;
+typedef struct TriggerEvent TriggerEvent;
+
+typedef bool (*RayFilter)(void *context, Line *line, Thing *thing);
+typedef void (*TriggerCallback)(void *context, TriggerEvent *events, int count);
+typedef void (*TriggerRelease)(void *context);
+
+enum TriggerType {
+    TRIGGER_AREA,
+    TRIGGER_LINE,
+};
+
+enum TriggerEventType {
+    TRIGGER_ENTER,
+    TRIGGER_EXIT,
+    TRIGGER_CROSS,
+};
+
+struct ThingStore {
+    float *x;
+    float *y;
+    float *z;
+    float *dx;
+    float *dy;
+    float *dz;
+    float *previous_x;
+    float *previous_z;
+    float *box;
+    float *height;
+    float *floor;
+    float *plane_x;
+    float *plane_z;
+    float *plane_d;
+    u8 *ground;
+    int *cell;
+    int *next;
+    int *previous;
+    u8 *rest;
+    Thing **touched;
+    u8 *step;
+    u8 *phase;
+};
+
+struct ParticlePool {
+    float *x;
+    float *y;
+    float *z;
+    float *dx;
+    float *dy;
+    float *dz;
+    float *floor;
+    float *ceiling;
+    float *life;
+    int *texture;
+    u8 *dead;
+    int count;
+    u32 seed;
+};
+
+struct SectorMover {
+    Sector *sec;
+    float floor;
+    float ceiling;
+    float speed;
+    float left;
+    float bottom;
+    float right;
+    float top;
+};
+
+struct Trigger {
+    enum TriggerType type;
+    float left;
+    float bottom;
+    float right;
+    float top;
+    float ax;
+    float az;
+    float bx;
+    float bz;
+    TriggerCallback callback;
+    TriggerRelease release;
+    void *context;
+    int c_min;
+    int r_min;
+    int c_max;
+    int r_max;
+};
+
+struct TriggerEvent {
+    int trigger;
+    enum TriggerEventType type;
+    unsigned int thing_id;
+    int thing_index;
+    Thing *thing;
+};
 
 struct World {
     char *name;
+    char *cache;
+    WorkerPool *workers;
     Line **lines;
     int line_count;
     Thing **things;
     int thing_cap;
     int thing_count;
+    unsigned int thing_next_id;
+    int thing_type_end[THING_TYPE_COUNT];
+    int thing_awake_end[THING_TYPE_COUNT];
+    ThingStore store;
+    float thing_box_max;
+    Thing **sweep_axis;
+    int sweep_count;
+    int sweep_cap;
+    int *sweep_pairs;
+    int sweep_pair_cap;
+    int *sweep_offsets;
+    int sweep_offset_cap;
+    int *sweep_partners;
+    int sweep_partner_cap;
+    Thing *focus;
+    int focus_cell;
+    int lod_cells[THING_LOD_LEVELS - 1];
+    int lod_cells_built[THING_LOD_LEVELS - 1];
+    u8 *cell_lod;
+    unsigned int tick;
     Thing **thing_sprites;
     int thing_sprites_cap;
     int thing_sprites_count;
     Thing **thing_models;
     int thing_models_cap;
     int thing_models_count;
-    Particle **particles;
-    int particle_cap;
-    int particle_count;
+    ParticlePool particles;
     Decal **decals;
     int decal_cap;
     int decal_count;
     Sector **sectors;
     int sector_cap;
     int sector_count;
+    SectorMover *movers;
+    int mover_cap;
+    int mover_count;
+    Thing **riders;
+    int rider_cap;
+    Sector **rebake;
+    int rebake_cap;
+    int rebake_count;
+    Light **lights;
+    int light_cap;
+    int light_count;
+    Trigger *triggers;
+    int trigger_cap;
+    int trigger_count;
+    TriggerEvent *trigger_events;
+    int trigger_event_cap;
+    int trigger_event_count;
+    WorkerLock *trigger_lock;
     Cell *cells;
     int columns;
     int rows;
     int cell_count;
+    int region_columns;
+    int region_rows;
+    int region_count;
+    int *region_offsets;
+    int *region_items;
+    int region_item_cap;
+    NavMesh *navmesh;
+    WorkerCounter *thing_tests;
+    WorkerCounter *line_tests;
 };
 
 World *new_world();
 
 void world_clear(World *this);
+void world_delete(World *this);
+void thing_store_reserve(World *this, int count);
 void world_add_thing(World *this, Thing *t);
+void world_wake_thing(World *this, Thing *t);
 void world_remove_thing(World *this, Thing *t);
-void world_add_particle(World *this, Particle *t);
-void world_remove_particle(World *this, Particle *t);
 void world_add_decal(World *this, Decal *t);
 void world_remove_decal(World *this, Decal *t);
 void world_add_sector(World *this, Sector *s);
+void world_add_light(World *this, Light *t);
+void world_remove_light(World *this, Light *t);
+float world_dynamic_light(World *this, float x, float y, float z);
+float world_light(World *this, Sector *s, float x, float y, float z);
 Sector *world_find_sector(World *this, float x, float y);
+void world_set_sector_heights(World *this, Sector *s, float floor, float ceiling);
+void world_move_sector(World *this, Sector *s, float floor, float ceiling, float speed);
+void world_set_sector_slope(World *this, Sector *s, float anchor_x, float anchor_z, float floor_x, float floor_z, float ceiling_x, float ceiling_z);
 void world_build(World *this, Array *lines);
 void world_update(World *this);
 
+void world_bake_lightmaps(World *this);
+void world_rebake_lightmaps(World *this);
+
+bool world_raycast(World *this, Ray *ray, RayFilter filter, void *context, RayHit *hit);
+void world_raycast_batch(World *this, Ray *rays, int count, RayFilter filter, void *context, RayHit *hits);
+
+int world_query_radius(World *this, float x, float z, float radius, Thing **results, int capacity);
+int world_query_box(World *this, float left, float bottom, float right, float top, Thing **results, int capacity);
+
+int world_add_area_trigger(World *this, float left, float bottom, float right, float top, TriggerCallback callback, void *context);
+int world_add_line_trigger(World *this, float ax, float az, float bx, float bz, TriggerCallback callback, void *context);
+void world_remove_trigger(World *this, int id);
+void world_bind_triggers(World *this);
+void world_dispatch_triggers(World *this);
+char *world_area_trigger_vm(Hymn *vm);
+char *world_line_trigger_vm(Hymn *vm);
+char *world_remove_trigger_vm(Hymn *vm);
+
+void light_falloff_init();
+void light_add_to_cells(Light *this);
+void light_remove_from_cells(Light *this);
+
 struct Cell {
     Line **lines;
     int line_count;
-    Thing **things;
-    int thing_cap;
+    Sector *sector;
+    Sector **sectors;
+    int sector_count;
+    int thing_head;
     int thing_count;
-    Particle **particles;
-    int particle_cap;
-    int particle_count;
     Decal **decals;
     int decal_cap;
     int decal_count;
+    Light **lights;
+    int light_cap;
+    int light_count;
+    int *triggers;
+    int trigger_cap;
+    int trigger_count;
+    int tests;
 };
 
 void cell_add_line(Cell *this, Line *ld);
-void cell_add_thing(Cell *this, Thing *t);
-void cell_remove_thing(Cell *this, Thing *t);
-void cell_add_particle(Cell *this, Particle *t);
-void cell_remove_particle(Cell *this, Particle *t);
+void cell_add_sector(Cell *this, Sector *s);
+void cell_add_thing(Cell *this, ThingStore *store, int index);
+void cell_remove_thing(Cell *this, ThingStore *store, int index);
 void cell_add_decal(Cell *this, Decal *t);
 void cell_remove_decal(Cell *this, Decal *t);
+void cell_add_light(Cell *this, Light *t);
+void cell_remove_light(Cell *this, Light *t);
+void cell_add_trigger(Cell *this, int trigger);
+void cell_remove_trigger(Cell *this, int trigger);
 
 struct Thing {
     unsigned int id;
     enum ThingType type;
+    int index;
+    int sweep_slot;
+    int sprite_slot;
     World *map;
     Sector *sec;
     int health;
-    float box;
-    float height;
     float speed;
-    float x;
-    float y;
-    float z;
-    float dx;
-    float dy;
-    float dz;
-    float previous_x;
-    float previous_z;
     float rotation;
     float rotation_target;
-    bool ground;
-    int c_min;
-    int r_min;
-    int c_max;
-    int r_max;
     int sprite_id;
     Sprite *sprite_data;
-    void (*update)(void *);
 };
 
-void thing_initialize(Thing *this, World *map, float x, float y, float r, float box, float height);
+void thing_add_to_cell(Thing *this);
+void thing_remove_from_cell(Thing *this);
+void thing_initialize(Thing *this, World *map, enum ThingType type, float x, float z, float r, float box, float height);
 void thing_block_borders(Thing *this);
-void thing_nop_update(void *this);
 void thing_standard_update(Thing *this);
+void thing_update_triggers(Thing *this);
+void thing_update_plane(Thing *this);
 
-struct Particle {
-    float box;
-    float height;
-    float x;
-    float y;
-    float z;
-    float dx;
-    float dy;
-    float dz;
-    int texture;
-    Sprite *sprite_data;
-    World *map;
-    Sector *sec;
-    bool (*update)(void *);
-};
+void things_lod_init();
+void things_schedule(World *map, int begin, int end);
+void things_friction(ThingStore *store, int begin, int end);
+void things_ground(ThingStore *store, int begin, int end);
+void things_gravity(ThingStore *store, int begin, int end);
+void things_broadphase(World *map);
+void things_move(World *map, int *ranges, int range_count);
 
-Particle *new_particle(World *map, float x, float y, float z, float box, float height);
-void particle_hit_floor(Particle *this);
-void particle_hit_ceiling(Particle *this);
-bool particle_line_collision(Particle *this, Line *ld);
-bool particle_map_collision(Particle *this);
+void particle_pool_init(ParticlePool *this);
+int particle_spawn(ParticlePool *this, Sector *sec, float x, float y, float z, float dx, float dy, float dz, float life, int texture);
+int particle_explosion(ParticlePool *this, Sector *sec, float x, float y, float z, float speed, float life, int count, int texture);
+void particles_integrate(ParticlePool *this, int begin, int end);
+void particles_compact(ParticlePool *this);
 
 struct Decal {
     float x1;
@@ -187,4 +375,39 @@ struct Decal {
 
 Decal *new_decal(World *map);
 
+struct Ray {
+    float x;
+    float z;
+    float dx;
+    float dz;
+    float distance;
+};
+
+struct RayHit {
+    float distance;
+    float x;
+    float z;
+    Line *line;
+    Thing *thing;
+};
+
+struct Light {
+    float x;
+    float y;
+    float z;
+    float radius;
+    float intensity;
+    bool is_static;
+    World *map;
+    int c_min;
+    int r_min;
+    int c_max;
+    int r_max;
+};
+
+Light *new_light(World *map, float x, float y, float z, float radius, float intensity);
+Light *new_static_light(World *map, float x, float y, float z, float radius, float intensity);
+void light_move(Light *this, float x, float y, float z);
+float light_sample(Light *this, float x, float y, float z);
+
 #endif
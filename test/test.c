@@ -3,6 +3,7 @@
 #include "test_set.h"
 #include "test_table.h"
 #include "test_uint_table.h"
+#include "test_world.h"
 
 int tests_success = 0;
 int tests_fail = 0;
@@ -14,6 +15,7 @@ int main() {
     TEST_SET(test_table_all);
     TEST_SET(test_uint_table_all);
     TEST_SET(test_set_all);
+    TEST_SET(test_world_all);
     printf("Success: %d, Failed: %d, Total: %d\n\n", tests_success, tests_fail, tests_count);
     return 0;
 }
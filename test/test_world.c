@@ -0,0 +1,733 @@
+#include "test_world.h"
+
+#define TEST_ROOM_LOW 4.0f
+#define TEST_ROOM_HIGH 124.0f
+
+static World *new_test_room() {
+    World *world = new_world();
+
+    Vec **vecs = safe_calloc(4, sizeof(Vec *));
+    vecs[0] = new_vec(TEST_ROOM_LOW, TEST_ROOM_LOW);
+    vecs[1] = new_vec(TEST_ROOM_LOW, TEST_ROOM_HIGH);
+    vecs[2] = new_vec(TEST_ROOM_HIGH, TEST_ROOM_HIGH);
+    vecs[3] = new_vec(TEST_ROOM_HIGH, TEST_ROOM_LOW);
+
+    Array *lines = new_array(0);
+    Line **sector_lines = safe_calloc(4, sizeof(Line *));
+    for (int i = 0; i < 4; i++) {
+        sector_lines[i] = new_line(vecs[i], vecs[(i + 1) % 4], LINE_NO_WALL, LINE_NO_WALL, LINE_NO_WALL);
+        array_push(lines, sector_lines[i]);
+    }
+
+    Sector *sector = new_sector(vecs, 4, sector_lines, 4, 0.0f, 0.0f, 10.0f, 10.0f, -1, -1);
+    world_add_sector(world, sector);
+    world_build(world, lines);
+
+    array_delete(lines);
+    return world;
+}
+
+#define TEST_STRIP_SECTORS 3
+#define TEST_STRIP_PAINT 0
+
+static World *new_test_strip(float *floors) {
+    World *world = new_world();
+
+    float width = (TEST_ROOM_HIGH - TEST_ROOM_LOW) / TEST_STRIP_SECTORS;
+    Vec *bottom[TEST_STRIP_SECTORS + 1];
+    Vec *top[TEST_STRIP_SECTORS + 1];
+    for (int i = 0; i <= TEST_STRIP_SECTORS; i++) {
+        bottom[i] = new_vec(TEST_ROOM_LOW + width * (float)i, TEST_ROOM_LOW);
+        top[i] = new_vec(TEST_ROOM_LOW + width * (float)i, TEST_ROOM_HIGH);
+    }
+
+    Array *lines = new_array(0);
+    Line *sides[TEST_STRIP_SECTORS + 1];
+    for (int i = 0; i <= TEST_STRIP_SECTORS; i++) {
+        sides[i] = new_line(bottom[i], top[i], LINE_NO_WALL, LINE_NO_WALL, LINE_NO_WALL);
+        array_push(lines, sides[i]);
+    }
+
+    for (int i = 0; i < TEST_STRIP_SECTORS; i++) {
+        Vec **vecs = safe_calloc(4, sizeof(Vec *));
+        vecs[0] = bottom[i];
+        vecs[1] = top[i];
+        vecs[2] = top[i + 1];
+        vecs[3] = bottom[i + 1];
+
+        Line **sector_lines = safe_calloc(4, sizeof(Line *));
+        sector_lines[0] = sides[i];
+        sector_lines[1] = new_line(top[i], top[i + 1], LINE_NO_WALL, LINE_NO_WALL, LINE_NO_WALL);
+        sector_lines[2] = sides[i + 1];
+        sector_lines[3] = new_line(bottom[i + 1], bottom[i], LINE_NO_WALL, LINE_NO_WALL, LINE_NO_WALL);
+        array_push(lines, sector_lines[1]);
+        array_push(lines, sector_lines[3]);
+
+        Sector *sector = new_sector(vecs, 4, sector_lines, 4, 0.0f, floors[i], 10.0f, 10.0f, TEST_STRIP_PAINT, TEST_STRIP_PAINT);
+        world_add_sector(world, sector);
+    }
+
+    world_build(world, lines);
+
+    array_delete(lines);
+    return world;
+}
+
+static float test_strip_center(int sector) {
+    float width = (TEST_ROOM_HIGH - TEST_ROOM_LOW) / TEST_STRIP_SECTORS;
+    return TEST_ROOM_LOW + width * ((float)sector + 0.5f);
+}
+
+static float test_random(unsigned int *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return (float)((*seed >> 8) % 10000) / 10000.0f;
+}
+
+static float test_room_random(unsigned int *seed) {
+    return TEST_ROOM_LOW + 2.0f + test_random(seed) * (TEST_ROOM_HIGH - TEST_ROOM_LOW - 4.0f);
+}
+
+static void test_room_things(World *world, int count, unsigned int seed) {
+    for (int i = 0; i < count; i++) {
+        float x = test_room_random(&seed);
+        float z = test_room_random(&seed);
+        float box = 0.2f + test_random(&seed) * 1.3f;
+        Thing *thing = safe_calloc(1, sizeof(Thing));
+        thing_initialize(thing, world, i == 0 ? THING_TYPE_HERO : THING_TYPE_BARON, x, z, 0.0f, box, 2.0f);
+        world->store.dx[thing->index] = (float)(i % 7) * 0.02f - 0.06f;
+        world->store.dz[thing->index] = (float)(i % 5) * 0.02f - 0.04f;
+        world_wake_thing(world, thing);
+    }
+}
+
+static bool test_cells_valid(World *world) {
+    ThingStore *store = &world->store;
+    int *seen = safe_calloc(world->thing_count, sizeof(int));
+    int total = 0;
+    bool valid = true;
+    for (int c = 0; c < world->cell_count; c++) {
+        Cell *cell = &world->cells[c];
+        int count = 0;
+        int previous = -1;
+        for (int k = cell->thing_head; k != -1; k = store->next[k]) {
+            if (k < 0 or k >= world->thing_count or store->cell[k] != c or store->previous[k] != previous or seen[k]++) {
+                valid = false;
+                break;
+            }
+            previous = k;
+            count++;
+        }
+        valid = valid and count == cell->thing_count;
+        total += count;
+    }
+    for (int i = 0; valid and i < world->thing_count; i++) {
+        valid = seen[i] == 1 and world->things[i]->index == i;
+    }
+    free(seen);
+    return valid and total == world->thing_count;
+}
+
+static int test_find(Thing **things, int count, Thing *thing) {
+    for (int i = 0; i < count; i++) {
+        if (things[i] == thing) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static float test_ray_line(float x, float z, float dx, float dz, Line *ld) {
+    float vx = ld->b->x - ld->a->x;
+    float vz = ld->b->y - ld->a->y;
+    float denominator = dx * vz - dz * vx;
+    if (fabsf(denominator) < 1e-6f) {
+        return FLT_MAX;
+    }
+    float wx = ld->a->x - x;
+    float wz = ld->a->y - z;
+    float t = (wx * vz - wz * vx) / denominator;
+    float u = (wx * dz - wz * dx) / denominator;
+    return t < 0.0f or u < 0.0f or u > 1.0f ? FLT_MAX : t;
+}
+
+static float test_ray_box(float x, float z, float dx, float dz, float cx, float cz, float box) {
+    float near = 0.0f;
+    float far = FLT_MAX;
+    float origin[2] = {x, z};
+    float direction[2] = {dx, dz};
+    float center[2] = {cx, cz};
+    for (int axis = 0; axis < 2; axis++) {
+        float low = center[axis] - box;
+        float high = center[axis] + box;
+        if (fabsf(direction[axis]) < 1e-6f) {
+            if (origin[axis] < low or origin[axis] > high) {
+                return FLT_MAX;
+            }
+            continue;
+        }
+        float t1 = (low - origin[axis]) / direction[axis];
+        float t2 = (high - origin[axis]) / direction[axis];
+        near = fmaxf(near, fminf(t1, t2));
+        far = fminf(far, fmaxf(t1, t2));
+    }
+    return near > far ? FLT_MAX : near;
+}
+
+static char *test_query() {
+    World *world = new_test_room();
+    test_room_things(world, 200, 3);
+
+    Thing *results[256];
+    unsigned int seed = 17;
+
+    for (int q = 0; q < 100; q++) {
+        float x = test_room_random(&seed);
+        float z = test_room_random(&seed);
+        float radius = 1.0f + test_random(&seed) * 20.0f;
+
+        int count = world_query_radius(world, x, z, radius, results, 256);
+        ASSERT("radius capacity", count <= 256);
+        int expected = 0;
+        for (int i = 0; i < world->thing_count; i++) {
+            ThingStore *store = &world->store;
+            float box = store->box[i];
+            float nearest_x = fminf(fmaxf(x, store->x[i] - box), store->x[i] + box) - x;
+            float nearest_z = fminf(fmaxf(z, store->z[i] - box), store->z[i] + box) - z;
+            if (nearest_x * nearest_x + nearest_z * nearest_z <= radius * radius) {
+                ASSERT("radius result", test_find(results, count, world->things[i]) != -1);
+                expected++;
+            }
+        }
+        ASSERT("radius count", count == expected);
+
+        float left = x - radius;
+        float right = x + radius * 0.5f;
+        float bottom = z - radius * 0.5f;
+        float top = z + radius;
+
+        count = world_query_box(world, left, bottom, right, top, results, 256);
+        expected = 0;
+        for (int i = 0; i < world->thing_count; i++) {
+            ThingStore *store = &world->store;
+            float box = store->box[i];
+            if (store->x[i] + box < left or store->x[i] - box > right or store->z[i] + box < bottom or store->z[i] - box > top) {
+                continue;
+            }
+            ASSERT("box result", test_find(results, count, world->things[i]) != -1);
+            expected++;
+        }
+        ASSERT("box count", count == expected);
+    }
+
+    int everything = world_query_box(world, 0.0f, 0.0f, TEST_ROOM_HIGH, TEST_ROOM_HIGH, results, 8);
+    ASSERT("truncated count", everything == world->thing_count);
+
+    world_delete(world);
+    return 0;
+}
+
+static char *test_raycast() {
+    World *world = new_test_room();
+    test_room_things(world, 100, 5);
+
+    unsigned int seed = 23;
+
+    for (int q = 0; q < 200; q++) {
+        float angle = test_random(&seed) * 6.2831853f;
+        Ray ray = {test_room_random(&seed), test_room_random(&seed), cosf(angle), sinf(angle), 500.0f};
+        RayHit hit;
+        world_raycast(world, &ray, NULL, NULL, &hit);
+
+        float expected = ray.distance;
+        for (int i = 0; i < world->line_count; i++) {
+            expected = fminf(expected, test_ray_line(ray.x, ray.z, ray.dx, ray.dz, world->lines[i]));
+        }
+        ThingStore *store = &world->store;
+        for (int i = 0; i < world->thing_count; i++) {
+            expected = fminf(expected, test_ray_box(ray.x, ray.z, ray.dx, ray.dz, store->x[i], store->z[i], store->box[i]));
+        }
+
+        ASSERT("ray distance", fabsf(hit.distance - expected) < 1e-3f);
+    }
+
+    world_delete(world);
+    return 0;
+}
+
+#define TEST_LANES 37
+
+static char *test_simd_ground() {
+    float arrays[2][8][TEST_LANES];
+    u8 ground[2][TEST_LANES];
+    u8 step[TEST_LANES];
+    unsigned int seed = 29;
+
+    for (int i = 0; i < TEST_LANES; i++) {
+        arrays[0][0][i] = test_random(&seed) * 100.0f;
+        arrays[0][1][i] = test_random(&seed) * 4.0f;
+        arrays[0][2][i] = test_random(&seed) * 100.0f;
+        arrays[0][3][i] = test_random(&seed) - 0.5f;
+        arrays[0][4][i] = 0.0f;
+        arrays[0][5][i] = (test_random(&seed) - 0.5f) * 0.1f;
+        arrays[0][6][i] = (test_random(&seed) - 0.5f) * 0.1f;
+        arrays[0][7][i] = test_random(&seed) * 2.0f;
+        ground[0][i] = (u8)(test_random(&seed) < 0.7f);
+        step[i] = (u8)(test_random(&seed) < 0.8f);
+    }
+    memcpy(arrays[1], arrays[0], sizeof(arrays[0]));
+    memcpy(ground[1], ground[0], sizeof(ground[0]));
+
+    for (int k = 0; k < 2; k++) {
+        ThingStore store = {0};
+        store.x = arrays[k][0];
+        store.y = arrays[k][1];
+        store.z = arrays[k][2];
+        store.dy = arrays[k][3];
+        store.floor = arrays[k][4];
+        store.plane_x = arrays[k][5];
+        store.plane_z = arrays[k][6];
+        store.plane_d = arrays[k][7];
+        store.ground = ground[k];
+        store.step = step;
+        if (k == 0) {
+            things_ground(&store, 0, TEST_LANES);
+        } else {
+            for (int i = 0; i < TEST_LANES; i++) {
+                things_ground(&store, i, i + 1);
+            }
+        }
+    }
+
+    ASSERT("ground floats", memcmp(arrays[0], arrays[1], sizeof(arrays[0])) == 0);
+    ASSERT("ground flags", memcmp(ground[0], ground[1], sizeof(ground[0])) == 0);
+    return 0;
+}
+
+static char *test_simd_particles() {
+    float arrays[2][9][TEST_LANES];
+    u8 dead[2][TEST_LANES];
+    unsigned int seed = 31;
+
+    for (int i = 0; i < TEST_LANES; i++) {
+        arrays[0][0][i] = test_random(&seed) * 100.0f;
+        arrays[0][1][i] = test_random(&seed) * 4.0f;
+        arrays[0][2][i] = test_random(&seed) * 100.0f;
+        arrays[0][3][i] = test_random(&seed) - 0.5f;
+        arrays[0][4][i] = test_random(&seed) - 0.2f;
+        arrays[0][5][i] = test_random(&seed) - 0.5f;
+        arrays[0][6][i] = test_random(&seed) * 2.0f;
+        arrays[0][7][i] = 2.0f + test_random(&seed) * 2.0f;
+        arrays[0][8][i] = (float)(int)(test_random(&seed) * 4.0f);
+    }
+    memcpy(arrays[1], arrays[0], sizeof(arrays[0]));
+
+    for (int k = 0; k < 2; k++) {
+        ParticlePool pool = {0};
+        pool.x = arrays[k][0];
+        pool.y = arrays[k][1];
+        pool.z = arrays[k][2];
+        pool.dx = arrays[k][3];
+        pool.dy = arrays[k][4];
+        pool.dz = arrays[k][5];
+        pool.floor = arrays[k][6];
+        pool.ceiling = arrays[k][7];
+        pool.life = arrays[k][8];
+        pool.dead = dead[k];
+        pool.count = TEST_LANES;
+        if (k == 0) {
+            particles_integrate(&pool, 0, TEST_LANES);
+        } else {
+            for (int i = 0; i < TEST_LANES; i++) {
+                particles_integrate(&pool, i, i + 1);
+            }
+        }
+    }
+
+    ASSERT("particle floats", memcmp(arrays[0], arrays[1], sizeof(arrays[0])) == 0);
+    ASSERT("particle flags", memcmp(dead[0], dead[1], sizeof(dead[0])) == 0);
+    return 0;
+}
+
+static char *test_cell_lists() {
+    World *world = new_test_room();
+    test_room_things(world, 150, 9);
+    ASSERT("cells after add", test_cells_valid(world));
+
+    unsigned int seed = 37;
+    for (int i = 0; i < 40; i++) {
+        int index = (int)(test_random(&seed) * (float)world->thing_count);
+        world_remove_thing(world, world->things[index]);
+    }
+    ASSERT("count after remove", world->thing_count == 110);
+    ASSERT("cells after remove", test_cells_valid(world));
+
+    for (int i = 0; i < 30; i++) {
+        world_update(world);
+    }
+    ASSERT("cells after update", test_cells_valid(world));
+
+    test_room_things(world, 20, 41);
+    ASSERT("cells after refill", test_cells_valid(world));
+
+    world_delete(world);
+    return 0;
+}
+
+static bool test_path_ends(NavPath *path, float x, float z) {
+    return path->count > 0 and fabsf(path->points[path->count * 2 - 2] - x) < 1e-3f and fabsf(path->points[path->count * 2 - 1] - z) < 1e-3f;
+}
+
+static char *test_navmesh_paths() {
+    float floors[TEST_STRIP_SECTORS] = {0.0f, 0.5f, 3.0f};
+    World *world = new_test_strip(floors);
+    NavMesh *mesh = world->navmesh;
+    ASSERT("nodes", mesh->node_count >= TEST_STRIP_SECTORS * 2);
+
+    float middle = (TEST_ROOM_LOW + TEST_ROOM_HIGH) * 0.5f;
+    NavPath path = {0};
+
+    ASSERT("same sector", navmesh_find_path(mesh, 0, test_strip_center(0), 10.0f, test_strip_center(0), 110.0f, &path));
+    ASSERT("same sector end", test_path_ends(&path, test_strip_center(0), 110.0f));
+
+    ASSERT("step up", navmesh_find_path(mesh, 0, test_strip_center(0), middle, test_strip_center(1), middle, &path));
+    ASSERT("step up end", test_path_ends(&path, test_strip_center(1), middle));
+
+    ASSERT("blocked step", !navmesh_find_path(mesh, 0, test_strip_center(0), middle, test_strip_center(2), middle, &path));
+    ASSERT("drop down", navmesh_find_path(mesh, 0, test_strip_center(2), middle, test_strip_center(0), middle, &path));
+    ASSERT("outside", !navmesh_find_path(mesh, 0, 1.0f, 1.0f, test_strip_center(0), middle, &path));
+
+    int blocked = 0;
+    for (int e = 0; e < mesh->edge_count; e++) {
+        NavEdge *edge = &mesh->edges[e];
+        Sector *from = mesh->nodes[edge->source].sec;
+        Sector *to = mesh->nodes[edge->target].sec;
+        bool up = from == world->sectors[1] and to == world->sectors[2];
+        ASSERT("blocked portal", edge->blocked == up);
+        blocked += up;
+    }
+    ASSERT("portal edges", blocked > 0);
+
+    int count = 64;
+    NavRequest *requests = safe_calloc(count, sizeof(NavRequest));
+    NavPath *serial = safe_calloc(count, sizeof(NavPath));
+    unsigned int seed = 43;
+    for (int i = 0; i < count; i++) {
+        requests[i].from_x = test_room_random(&seed);
+        requests[i].from_z = test_room_random(&seed);
+        requests[i].to_x = test_room_random(&seed);
+        requests[i].to_z = test_room_random(&seed);
+        requests[i].path = safe_calloc(1, sizeof(NavPath));
+    }
+    navmesh_find_paths(mesh, requests, count);
+
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        NavRequest *request = &requests[i];
+        bool expected = navmesh_find_path(mesh, 0, request->from_x, request->from_z, request->to_x, request->to_z, &serial[i]);
+        ASSERT("batch found", request->found == expected);
+        ASSERT("batch count", request->path->count == serial[i].count);
+        ASSERT("batch points", serial[i].count == 0 or memcmp(request->path->points, serial[i].points, serial[i].count * 2 * sizeof(float)) == 0);
+        found += expected;
+        nav_path_release(request->path);
+        free(request->path);
+        nav_path_release(&serial[i]);
+    }
+    ASSERT("batch mixed", found > 0 and found < count);
+
+    free(requests);
+    free(serial);
+    nav_path_release(&path);
+    world_delete(world);
+    return 0;
+}
+
+static char *test_navmesh_slopes() {
+    float floors[TEST_STRIP_SECTORS] = {0.0f, 0.0f, 3.0f};
+    World *world = new_test_strip(floors);
+    NavMesh *mesh = world->navmesh;
+    Sector *ramp = world->sectors[1];
+
+    float width = (TEST_ROOM_HIGH - TEST_ROOM_LOW) / TEST_STRIP_SECTORS;
+    float left = TEST_ROOM_LOW + width;
+    float middle = (TEST_ROOM_LOW + TEST_ROOM_HIGH) * 0.5f;
+    NavPath path = {0};
+
+    ASSERT("flat step", !navmesh_find_path(mesh, 0, test_strip_center(0), middle, test_strip_center(2), middle, &path));
+
+    world_set_sector_slope(world, ramp, left, middle, 3.0f / width, 0.0f, 0.0f, 0.0f);
+    ASSERT("ramp up", navmesh_find_path(mesh, 0, test_strip_center(0), middle, test_strip_center(2), middle, &path));
+    ASSERT("ramp end", test_path_ends(&path, test_strip_center(2), middle));
+
+    world_set_sector_slope(world, ramp, left, middle, -3.0f / width, 0.0f, 0.0f, 0.0f);
+    world_set_sector_heights(world, world->sectors[2], 0.0f, 10.0f);
+    ASSERT("steep slope", !navmesh_find_path(mesh, 0, test_strip_center(0), middle, test_strip_center(2), middle, &path));
+    ASSERT("steep drop", navmesh_find_path(mesh, 0, test_strip_center(2), middle, test_strip_center(0), middle, &path));
+
+    nav_path_release(&path);
+    world_delete(world);
+    return 0;
+}
+
+static u8 *test_texels(Lightmap *map) {
+    usize size = (usize)(map->width * map->height);
+    u8 *texels = safe_malloc(size);
+    memcpy(texels, map->texels, size);
+    return texels;
+}
+
+static char *test_rebake_lightmaps() {
+    float floors[TEST_STRIP_SECTORS] = {0.0f, 0.0f, 0.0f};
+    World *world = new_test_strip(floors);
+    Sector *moved = world->sectors[1];
+
+    for (int i = 0; i < world->sector_count; i++) {
+        world->sectors[i]->light = 0.2f;
+    }
+    float middle = (TEST_ROOM_LOW + TEST_ROOM_HIGH) * 0.5f;
+    new_static_light(world, test_strip_center(1), 9.0f, middle, 40.0f, 0.6f);
+    world_bake_lightmaps(world);
+
+    Lightmap *map = moved->floor_lightmap;
+    u8 *before = test_texels(map);
+    u8 *other = test_texels(world->sectors[0]->floor_lightmap);
+    usize size = (usize)(map->width * map->height);
+
+    world_set_sector_heights(world, moved, 6.0f, 10.0f);
+    ASSERT("dirty", moved->lightmap_dirty and world->rebake_count == 1);
+    world_update(world);
+    ASSERT("clean", !moved->lightmap_dirty and world->rebake_count == 0);
+    ASSERT("same lightmap", moved->floor_lightmap == map);
+    ASSERT("rebaked", memcmp(before, map->texels, size) != 0);
+
+    u8 *rebaked = test_texels(map);
+    world_bake_lightmaps(world);
+    ASSERT("matches full bake", memcmp(rebaked, moved->floor_lightmap->texels, size) == 0);
+    ASSERT("neighbour untouched", memcmp(other, world->sectors[0]->floor_lightmap->texels, size) == 0);
+
+    free(before);
+    free(other);
+    free(rebaked);
+    world_delete(world);
+    return 0;
+}
+
+static Thing *test_goal(World *world, float x, float z) {
+    Thing *thing = safe_calloc(1, sizeof(Thing));
+    thing_initialize(thing, world, THING_TYPE_HERO, x, z, 0.0f, 0.5f, 2.0f);
+    return thing;
+}
+
+static void test_goal_move(World *world, Thing *goal, float x, float z) {
+    world->store.x[goal->index] = x;
+    world->store.z[goal->index] = z;
+}
+
+static char *test_flow_field_refresh() {
+    float floors[TEST_STRIP_SECTORS] = {0.0f, 0.5f, 0.0f};
+    World *world = new_test_strip(floors);
+    NavMesh *mesh = world->navmesh;
+
+    int node = 0;
+    Thing *goal = test_goal(world, mesh->nodes[node].x, mesh->nodes[node].z);
+    Thing *fresh = test_goal(world, mesh->nodes[node].x, mesh->nodes[node].z);
+
+    unsigned int seed = 47;
+    int incremental = 0;
+    for (int step = 0; step < 200; step++) {
+        int begin = mesh->edge_offsets[node];
+        int count = mesh->edge_offsets[node + 1] - begin;
+        if (count > 0) {
+            node = mesh->edges[begin + (int)(test_random(&seed) * (float)count)].target;
+        }
+        float x = mesh->nodes[node].x;
+        float z = mesh->nodes[node].z;
+
+        test_goal_move(world, goal, x, z);
+        test_goal_move(world, fresh, x, z);
+        FlowField *field = navmesh_flow_field(mesh, goal);
+        navmesh_forget(mesh, fresh);
+        FlowField *reference = navmesh_flow_field(mesh, fresh);
+
+        ASSERT("goal node", field->goal_node == node and reference->goal_node == node);
+        ASSERT("reference bias", reference->bias == 0.0f);
+        incremental += field->bias > 0.0f;
+
+        for (int n = 0; n < mesh->node_count; n++) {
+            float expected = reference->distance[n];
+            if (expected == FLT_MAX) {
+                ASSERT("unreachable", field->distance[n] == FLT_MAX);
+                continue;
+            }
+            float actual = field->distance[n] + field->bias;
+            ASSERT("distance", fabsf(actual - expected) <= 1e-3f * (1.0f + expected));
+        }
+    }
+    ASSERT("incremental steps", incremental > 0);
+
+    world_delete(world);
+    return 0;
+}
+
+static char *test_flow_field_invalidate() {
+    float floors[TEST_STRIP_SECTORS] = {0.0f, 0.0f, 0.0f};
+    World *world = new_test_strip(floors);
+    NavMesh *mesh = world->navmesh;
+    Sector *high = world->sectors[2];
+
+    float middle = (TEST_ROOM_LOW + TEST_ROOM_HIGH) * 0.5f;
+    Thing *goal = test_goal(world, test_strip_center(2), middle);
+    int start = navmesh_locate(mesh, test_strip_center(0), middle);
+
+    FlowField *field = navmesh_flow_field(mesh, goal);
+    ASSERT("reachable", field->distance[start] < FLT_MAX and field->next[start] != -1);
+
+    world_set_sector_heights(world, high, 3.0f, 10.0f);
+    ASSERT("invalidated", field->goal_node == -2);
+    field = navmesh_flow_field(mesh, goal);
+    ASSERT("blocked", field->distance[start] == FLT_MAX and field->next[start] == -1);
+
+    world_set_sector_heights(world, high, 3.0f, 12.0f);
+    ASSERT("unchanged portals", field->goal_node != -2);
+
+    world_set_sector_heights(world, high, 0.0f, 10.0f);
+    ASSERT("invalidated again", field->goal_node == -2);
+    field = navmesh_flow_field(mesh, goal);
+    ASSERT("reachable again", field->distance[start] < FLT_MAX and field->next[start] != -1);
+
+    world_delete(world);
+    return 0;
+}
+
+static char *test_snapshot_round_trip() {
+    World *world = new_test_room();
+    test_room_things(world, 40, 7);
+
+    for (int i = 0; i < 10; i++) {
+        world_update(world);
+    }
+
+    Snapshot snapshot = {0};
+    world_snapshot(world, &snapshot);
+    u64 expected = world_state_hash(world);
+
+    Sector *sector = world->sectors[0];
+    world_set_sector_slope(world, sector, 32.0f, 32.0f, 0.05f, 0.0f, 0.0f, 0.0f);
+    test_room_things(world, 10, 11);
+    world_remove_thing(world, world->things[3]);
+    for (int i = 0; i < 20; i++) {
+        world_update(world);
+    }
+
+    ASSERT("mutated", world_state_hash(world) != expected);
+    ASSERT("restore", world_restore(world, &snapshot));
+    ASSERT("hash", world_state_hash(world) == expected);
+    ASSERT("thing count", world->thing_count == 40);
+    ASSERT("slope", sector->floor_plane.x == 0.0f and sector->floor_plane.z == 0.0f);
+
+    for (int i = 0; i < 10; i++) {
+        world_update(world);
+    }
+    u64 replayed = world_state_hash(world);
+
+    ASSERT("restore again", world_restore(world, &snapshot));
+    for (int i = 0; i < 10; i++) {
+        world_update(world);
+    }
+    ASSERT("deterministic", world_state_hash(world) == replayed);
+
+    snapshot_release(&snapshot);
+    world_delete(world);
+    return 0;
+}
+
+#define TEST_REPLAY_TICKS 120
+#define TEST_REPLAY_PATH "test_replay.tmp"
+
+static int test_replay_play(Replay *replay, World *world) {
+    Input input = {0};
+    u64 expected = 0;
+    int frames = 0;
+    while (replay_next(replay, &input, &expected)) {
+        world_update(world);
+        if (world_state_hash(world) != expected) {
+            replay->desyncs++;
+        }
+        frames++;
+    }
+    return frames;
+}
+
+static char *test_replay() {
+    World *world = new_test_room();
+    test_room_things(world, 40, 13);
+    for (int i = 0; i < 5; i++) {
+        world_update(world);
+    }
+
+    Replay *replay = new_replay(world);
+    world_move_sector(world, world->sectors[0], 2.0f, 10.0f, 0.05f);
+    Input input = {0};
+    for (int i = 0; i < TEST_REPLAY_TICKS; i++) {
+        input.move_up = i & 1;
+        input.mouse_x = i;
+        world_update(world);
+        replay_record(replay, &input, world_state_hash(world));
+    }
+    u64 end = world_state_hash(world);
+
+    ASSERT("begin", replay_begin(replay, world));
+    world_move_sector(world, world->sectors[0], 2.0f, 10.0f, 0.05f);
+    ASSERT("frames", test_replay_play(replay, world) == TEST_REPLAY_TICKS);
+    ASSERT("desyncs", replay->desyncs == 0);
+    ASSERT("end", world_state_hash(world) == end);
+
+    ASSERT("save", replay_save(replay, TEST_REPLAY_PATH));
+    Replay *loaded = replay_load(TEST_REPLAY_PATH);
+    ASSERT("load", loaded != NULL and loaded->count == TEST_REPLAY_TICKS);
+    ASSERT("input", loaded->frames[7].mouse_x == 7 and loaded->frames[7].buttons == replay->frames[7].buttons);
+    ASSERT("begin loaded", replay_begin(loaded, world));
+    world_move_sector(world, world->sectors[0], 2.0f, 10.0f, 0.05f);
+    test_replay_play(loaded, world);
+    ASSERT("loaded desyncs", loaded->desyncs == 0);
+    replay_delete(loaded);
+
+    FILE *fp = fopen(TEST_REPLAY_PATH, "r+b");
+    ASSERT("open", fp != NULL);
+    i32 count = 1 << 30;
+    fseek(fp, 2 * sizeof(u32), SEEK_SET);
+    fwrite(&count, sizeof(i32), 1, fp);
+    fclose(fp);
+    ASSERT("oversized count", replay_load(TEST_REPLAY_PATH) == NULL);
+
+    fp = fopen(TEST_REPLAY_PATH, "r+b");
+    ASSERT("open", fp != NULL);
+    count = TEST_REPLAY_TICKS;
+    u64 start = (u64)1 << 40;
+    fseek(fp, 2 * sizeof(u32), SEEK_SET);
+    fwrite(&count, sizeof(i32), 1, fp);
+    fseek(fp, (long)(3 * sizeof(u32) + TEST_REPLAY_TICKS * sizeof(ReplayFrame)), SEEK_SET);
+    fwrite(&start, sizeof(u64), 1, fp);
+    fclose(fp);
+    ASSERT("oversized start", replay_load(TEST_REPLAY_PATH) == NULL);
+    remove(TEST_REPLAY_PATH);
+
+    replay_delete(replay);
+    world_delete(world);
+    return 0;
+}
+
+char *test_world_all() {
+    TEST(test_query);
+    TEST(test_raycast);
+    TEST(test_simd_ground);
+    TEST(test_simd_particles);
+    TEST(test_cell_lists);
+    TEST(test_navmesh_paths);
+    TEST(test_navmesh_slopes);
+    TEST(test_flow_field_refresh);
+    TEST(test_flow_field_invalidate);
+    TEST(test_rebake_lightmaps);
+    TEST(test_snapshot_round_trip);
+    TEST(test_replay);
+    return 0;
+}
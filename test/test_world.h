@@ -0,0 +1,6 @@
+#include "replay.h"
+#include "snapshot.h"
+#include "test.h"
+#include "world.h"
+
+char *test_world_all();